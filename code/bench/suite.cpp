@@ -0,0 +1,538 @@
+#include "tokenizer.h"
+#include "handler.h"
+#include "symbols.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+// Tokenizer benchmark suite on generated workloads, see README.
+// Usage: suite [--json] [--retain] [--presize] [--split BYTES] [--read-ahead N] [--scale N] [--repetitions N] [--threads N] [--data DIRECTORY] [WORKLOAD...]
+
+namespace
+{
+    // Allocations made while a measurement is running, from any thread
+    std::atomic<bool> counting {false};
+    std::atomic<std::size_t> allocation_count {0};
+    std::atomic<std::size_t> allocation_bytes {0};
+
+    void *allocate(std::size_t size)
+    {
+        if(counting.load(std::memory_order_relaxed))
+        {
+            allocation_count.fetch_add(1, std::memory_order_relaxed);
+            allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+        }
+        void *pointer = std::malloc((size > 0) ? size : 1);
+        if(pointer == nullptr)
+            throw std::bad_alloc{};
+        return pointer;
+    }
+}
+
+void *operator new(std::size_t size) { return allocate(size); }
+void *operator new[](std::size_t size) { return allocate(size); }
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete[](void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, std::size_t) noexcept { std::free(pointer); }
+
+namespace
+{
+    /* Deterministic generator of eJSON text, the same seed gives the same files everywhere */
+    class Generator
+    {
+    private:
+        std::uint64_t _state;
+
+    public:
+        explicit Generator(std::uint64_t seed) : _state{seed} {}
+
+        // splitmix64
+        std::uint64_t next()
+        {
+            std::uint64_t z = (_state += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31);
+        }
+        std::size_t below(std::size_t bound) { return static_cast<std::size_t>(next() % bound); }
+
+        void key(std::string &text, std::size_t index)
+        {
+            static const char *const names[] = {"compatible", "reg", "status", "interrupts", "clocks",
+                                                "address-cells", "size-cells", "label", "pinctrl", "ranges"};
+            text += '"';
+            text += names[below(10)];
+            text += '-';
+            text += std::to_string(index);
+            text += "\": ";
+        }
+
+        void word(std::string &text, std::size_t length)
+        {
+            static const char letters[] = "abcdefghijklmnopqrstuvwxyz0123456789-_,.@/ ";
+            for(std::size_t index = 0; index < length; ++index)
+                text += letters[below(sizeof(letters) - 1)];
+        }
+
+        void number(std::string &text)
+        {
+            char digits[32];
+            switch (below(4))
+            {
+            case 0:
+                std::snprintf(digits, sizeof(digits), "%llu", static_cast<unsigned long long>(below(100000)));
+                break;
+            case 1:
+                std::snprintf(digits, sizeof(digits), "-%llu", static_cast<unsigned long long>(below(1000)));
+                break;
+            case 2:
+                std::snprintf(digits, sizeof(digits), "0x%08llx", static_cast<unsigned long long>(next() & 0xffffffffull));
+                break;
+            default:
+                std::snprintf(digits, sizeof(digits), "%llu.%03llue-%llu", static_cast<unsigned long long>(below(1000)),
+                              static_cast<unsigned long long>(below(1000)), static_cast<unsigned long long>(below(10)));
+                break;
+            }
+            text += digits;
+        }
+
+        // A short value of any kind, followed by its separator
+        void value(std::string &text)
+        {
+            switch (below(4))
+            {
+            case 0:
+                number(text);
+                break;
+            case 1:
+                text += (below(2) == 0) ? "true" : "null";
+                break;
+            case 2:
+                text += '"';
+                word(text, 4 + below(24));
+                text += '"';
+                break;
+            default:
+                text += "[ ";
+                for(std::size_t index = below(6); index > 0; --index)
+                {
+                    number(text);
+                    text += ", ";
+                }
+                text += "]";
+                break;
+            }
+            text += ",\n";
+        }
+    };
+
+    typedef std::function<void(Generator &, std::string &, std::size_t)> BodyWriter;
+
+    // Object with many keys on one level
+    void wideBody(Generator &generator, std::string &text, std::size_t bytes)
+    {
+        for(std::size_t index = 0; text.size() < bytes; ++index)
+        {
+            text += '\t';
+            generator.key(text, index);
+            generator.value(text);
+        }
+    }
+
+    // Objects and arrays nested hundreds of levels deep, well within MAX_SCOPE_DEPTH
+    void deepBody(Generator &generator, std::string &text, std::size_t bytes)
+    {
+        const std::size_t depth = 200;
+        for(std::size_t tree = 0; text.size() < bytes; ++tree)
+        {
+            generator.key(text, tree);
+            for(std::size_t level = 0; level < depth; ++level)
+            {
+                text += (level % 2 == 0) ? "{ " : "[ ";
+                if(level % 2 == 0)
+                {
+                    generator.key(text, level);
+                    generator.value(text);
+                    generator.key(text, level + 1);
+                }
+            }
+            generator.value(text);
+            for(std::size_t level = depth; level > 0; --level)
+                text += (level % 2 == 1) ? "},\n" : "],\n";
+        }
+    }
+
+    // Strings of kilobytes
+    void stringsBody(Generator &generator, std::string &text, std::size_t bytes)
+    {
+        for(std::size_t index = 0; text.size() < bytes; ++index)
+        {
+            generator.key(text, index);
+            text += '"';
+            generator.word(text, 1024 + generator.below(8192));
+            text += "\",\n";
+        }
+    }
+
+    // Arrays of numbers of every form
+    void numbersBody(Generator &generator, std::string &text, std::size_t bytes)
+    {
+        for(std::size_t index = 0; text.size() < bytes; ++index)
+        {
+            generator.key(text, index);
+            text += "[";
+            for(std::size_t count = 0; count < 64; ++count)
+            {
+                generator.number(text);
+                text += ", ";
+            }
+            text += "],\n";
+        }
+    }
+
+    // A comment on every line and between most values
+    void commentsBody(Generator &generator, std::string &text, std::size_t bytes)
+    {
+        for(std::size_t index = 0; text.size() < bytes; ++index)
+        {
+            text += "\t# ";
+            generator.word(text, 20 + generator.below(60));
+            text += "\n\t";
+            generator.key(text, index);
+            text.pop_back();
+            text += " # ";
+            generator.word(text, 10);
+            text += "\n\t";
+            generator.value(text);
+        }
+    }
+
+    bool writeFile(const std::string &path, const std::string &text)
+    {
+        std::ofstream stream{path, std::ios::binary | std::ios::trunc};
+        stream << text;
+        return !stream.fail();
+    }
+
+    // Workload of a single file, returns its path or an empty path if it cannot be written
+    std::string writeSingleFile(const std::string &directory, const std::string &name, std::uint64_t seed,
+                                const BodyWriter &body, std::size_t bytes)
+    {
+        Generator generator{seed};
+        std::string text {"# generated by bench/suite\n{\n"};
+        body(generator, text, bytes);
+        text += "}\n";
+        const std::string path = directory + "/" + name + ".ejson";
+        return writeFile(path, text) ? path : std::string{};
+    }
+
+    // Import DAG: every file imports the next one and a few more of the files after it,
+    // so that all files are reached and many are shared
+    std::string writeImportGraph(const std::string &directory, std::uint64_t seed, std::size_t files, std::size_t bytes)
+    {
+        Generator generator{seed};
+        const std::string folder = directory + "/imports";
+        ::mkdir(folder.c_str(), 0755);
+        for(std::size_t file = 0; file < files; ++file)
+        {
+            std::string text {};
+            const std::size_t window = std::min<std::size_t>(files - file - 1, 40);
+            for(std::size_t count = (window > 0) ? 1 + generator.below(4) : 0; count > 0; --count)
+            {
+                const std::size_t imported = (count == 1) ? file + 1 : file + 1 + generator.below(window);
+                text += "import \"./node-" + std::to_string(imported) + ".ejson\"\n";
+            }
+            text += "{\n";
+            wideBody(generator, text, text.size() + bytes / files);
+            text += "}\n";
+            if(!writeFile(folder + "/node-" + std::to_string(file) + ".ejson", text))
+                return std::string{};
+        }
+        return folder + "/node-0.ejson";
+    }
+
+    // Counts tokens and files without keeping them
+    struct CountingHandler : ejson::TokenHandler
+    {
+        std::size_t tokens {0};
+        std::size_t files {0};
+        void onFileBegin(ejson::StringView) override { ++files; }
+        void onObjectBegin() override { ++tokens; }
+        void onObjectEnd() override { ++tokens; }
+        void onArrayBegin() override { ++tokens; }
+        void onArrayEnd() override { ++tokens; }
+        void onKey(ejson::StringView) override { ++tokens; }
+        void onString(ejson::StringView) override { ++tokens; }
+        void onNumberValue(ejson::StringView, const ejson::Number &) override { ++tokens; }
+        void onLiteral(ejson::Token, ejson::StringView) override { ++tokens; }
+    };
+
+    struct Workload
+    {
+        std::string name;
+        std::string root;
+        std::size_t files;
+        std::size_t bytes;
+    };
+
+    // Tokens, allocations and time of one call, the time is the best of all repetitions
+    struct Measurement
+    {
+        std::size_t tokens {0};
+        std::size_t files {0};
+        std::size_t allocations {0};
+        std::size_t allocated_bytes {0};
+        double seconds {0.0};
+        bool ok {true};
+    };
+
+    long peakResidentKilobytes()
+    {
+        struct rusage usage;
+        ::getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+
+    // Pairs of the call before are handed back to a tokenizer retaining its scratch state
+    ejson::TokenizerFeedback tokenizeOnce(ejson::Tokenizer &tokenizer, const std::string &api, const std::string &root,
+                                          bool retain, ejson::ListOfTokenizedPairs &list, Measurement &measurement)
+    {
+        ejson::TokenizerFeedback feedback {};
+        measurement.tokens = 0;
+        if((api == "pairs") || (api == "interned"))
+        {
+            if(retain)
+                tokenizer.recycle(list);
+            else
+                list = ejson::ListOfTokenizedPairs{};
+            ejson::SymbolTable symbols {};
+            feedback = (api == "pairs") ? tokenizer.tokenize(root, list) : tokenizer.tokenize(root, list, symbols);
+            for(const ejson::TokenizedPairs &pairs : list)
+                measurement.tokens += pairs.size();
+            measurement.files = list.size();
+        }
+        else if(api == "views")
+        {
+            ejson::ListOfTokenizedFiles list {};
+            feedback = tokenizer.tokenize(root, list);
+            for(const ejson::TokenizedFile &file : list)
+                measurement.tokens += file.views.size();
+            measurement.files = list.size();
+        }
+        else if(api == "columns")
+        {
+            ejson::ListOfTokenColumns list {};
+            feedback = tokenizer.tokenize(root, list);
+            for(const ejson::TokenColumns &columns : list)
+                measurement.tokens += columns.size();
+            measurement.files = list.size();
+        }
+        else
+        {
+            CountingHandler handler {};
+            feedback = tokenizer.tokenize(root, handler);
+            measurement.tokens = handler.tokens;
+            measurement.files = handler.files;
+        }
+        return feedback;
+    }
+
+    Measurement measure(const Workload &workload, const std::string &api, std::size_t repetitions, std::size_t threads,
+                        bool retain, bool presize, std::size_t split, std::size_t read_ahead)
+    {
+        ejson::TokenizerOptions options {};
+        options.worker_threads = threads;
+        options.retain_scratch = retain;
+        options.presize_tokens = presize;
+        options.split_size = split;
+        options.read_ahead = read_ahead;
+        ejson::Tokenizer tokenizer {options};
+        ejson::ListOfTokenizedPairs list {};
+        Measurement measurement {};
+
+        // The first call is counted for allocations and warms up the page cache,
+        // a tokenizer retaining its scratch state is counted in steady use
+        ejson::TokenizerFeedback feedback {};
+        if(retain)
+            feedback = tokenizeOnce(tokenizer, api, workload.root, retain, list, measurement);
+        allocation_count = 0;
+        allocation_bytes = 0;
+        counting = true;
+        if(feedback.type == ejson::FeedbackType::OK)
+            feedback = tokenizeOnce(tokenizer, api, workload.root, retain, list, measurement);
+        counting = false;
+        measurement.allocations = allocation_count;
+        measurement.allocated_bytes = allocation_bytes;
+
+        for(std::size_t repetition = 0; (repetition < repetitions) && (feedback.type == ejson::FeedbackType::OK); ++repetition)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            feedback = tokenizeOnce(tokenizer, api, workload.root, retain, list, measurement);
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            if((repetition == 0) || (seconds < measurement.seconds))
+                measurement.seconds = seconds;
+        }
+        if(feedback.type != ejson::FeedbackType::OK)
+        {
+            std::cerr << workload.name << ": tokenization failed in " << feedback.file << ": " << feedback.snap << std::endl;
+            measurement.ok = false;
+        }
+        return measurement;
+    }
+
+    bool selected(const std::vector<std::string> &filters, const std::string &name)
+    {
+        return filters.empty() || (std::find(std::begin(filters), std::end(filters), name) != std::end(filters));
+    }
+
+    std::size_t fileSize(const std::string &path)
+    {
+        struct stat status;
+        return (::stat(path.c_str(), &status) == 0) ? static_cast<std::size_t>(status.st_size) : 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bool json {false};
+    bool retain {false};
+    bool presize {false};
+    std::size_t split {0};
+    std::size_t read_ahead {0};
+    std::size_t scale {1};
+    std::size_t repetitions {5};
+    std::size_t threads {1};
+    std::string directory {"./bench-data"};
+    std::vector<std::string> filters {};
+    for(int index = 1; index < argc; ++index)
+    {
+        const std::string argument {argv[index]};
+        const bool has_value = (index + 1 < argc);
+        if(argument == "--json")
+            json = true;
+        else if(argument == "--retain")
+            retain = true;
+        else if(argument == "--presize")
+            presize = true;
+        else if((argument == "--split") && has_value)
+            split = std::strtoul(argv[++index], nullptr, 10);
+        else if((argument == "--read-ahead") && has_value)
+            read_ahead = std::strtoul(argv[++index], nullptr, 10);
+        else if((argument == "--scale") && has_value)
+            scale = std::strtoul(argv[++index], nullptr, 10);
+        else if((argument == "--repetitions") && has_value)
+            repetitions = std::strtoul(argv[++index], nullptr, 10);
+        else if((argument == "--threads") && has_value)
+            threads = std::strtoul(argv[++index], nullptr, 10);
+        else if((argument == "--data") && has_value)
+            directory = argv[++index];
+        else if(!argument.empty() && (argument[0] != '-'))
+            filters.push_back(argument);
+        else
+        {
+            std::cerr << "usage: suite [--json] [--retain] [--presize] [--split BYTES] [--read-ahead N] [--scale N] [--repetitions N] [--threads N] [--data DIRECTORY] [WORKLOAD...]" << std::endl;
+            return 2;
+        }
+    }
+    scale = std::max<std::size_t>(scale, 1);
+    repetitions = std::max<std::size_t>(repetitions, 1);
+
+    // Every workload has a seed of its own, so that selecting workloads does not change the others
+    const std::size_t megabyte = 1024 * 1024;
+    const struct
+    {
+        const char *name;
+        BodyWriter body;
+    } single_files[] = {
+        {"wide", wideBody},
+        {"deep", deepBody},
+        {"strings", stringsBody},
+        {"numbers", numbersBody},
+        {"comments", commentsBody},
+    };
+    ::mkdir(directory.c_str(), 0755);
+    std::vector<Workload> workloads {};
+    std::uint64_t seed {1};
+    for(const auto &single_file : single_files)
+    {
+        ++seed;
+        if(selected(filters, single_file.name))
+        {
+            const std::string root = writeSingleFile(directory, single_file.name, seed, single_file.body, 4 * megabyte * scale);
+            workloads.push_back(Workload{single_file.name, root, 1, fileSize(root)});
+        }
+    }
+    if(selected(filters, "imports"))
+    {
+        const std::size_t files = 400 * scale;
+        const std::string root = writeImportGraph(directory, ++seed, files, 4 * megabyte * scale);
+        std::size_t bytes {0};
+        for(std::size_t file = 0; file < files; ++file)
+            bytes += fileSize(directory + "/imports/node-" + std::to_string(file) + ".ejson");
+        workloads.push_back(Workload{"imports", root, files, bytes});
+    }
+    for(const Workload &workload : workloads)
+    {
+        if(workload.root.empty())
+        {
+            std::cerr << "cannot write workloads to " << directory << std::endl;
+            return 1;
+        }
+    }
+
+    if(!json)
+        std::cout << std::left << std::setw(10) << "workload" << std::setw(9) << "api" << std::right
+                  << std::setw(7) << "files" << std::setw(11) << "MB" << std::setw(11) << "MB/s"
+                  << std::setw(11) << "Mtokens/s" << std::setw(13) << "allocations" << std::setw(13) << "peak RSS kB" << std::endl;
+    bool ok {true};
+    const char *const apis[] = {"pairs", "interned", "views", "columns", "handler"};
+    for(const Workload &workload : workloads)
+    {
+        for(const char *api : apis)
+        {
+            const Measurement measurement = measure(workload, api, repetitions, threads, retain, presize, split, read_ahead);
+            ok = ok && measurement.ok;
+            const double megabytes = static_cast<double>(workload.bytes) / 1e6;
+            const double throughput = measurement.ok ? megabytes / measurement.seconds : 0.0;
+            const double token_rate = measurement.ok ? static_cast<double>(measurement.tokens) / measurement.seconds / 1e6 : 0.0;
+            // Peak RSS is that of the process so far, it grows with the largest workload measured
+            const long peak_rss = peakResidentKilobytes();
+            if(json)
+                std::cout << "{\"workload\": \"" << workload.name << "\", \"api\": \"" << api
+                          << "\", \"ok\": " << (measurement.ok ? "true" : "false")
+                          << ", \"scale\": " << scale << ", \"threads\": " << threads << ", \"retain\": " << (retain ? "true" : "false")
+                          << ", \"presize\": " << (presize ? "true" : "false") << ", \"split\": " << split << ", \"read_ahead\": " << read_ahead
+                          << ", \"repetitions\": " << repetitions
+                          << ", \"files\": " << measurement.files << ", \"bytes\": " << workload.bytes
+                          << ", \"tokens\": " << measurement.tokens << ", \"seconds\": " << measurement.seconds
+                          << ", \"mb_per_s\": " << throughput << ", \"tokens_per_s\": " << token_rate * 1e6
+                          << ", \"allocations\": " << measurement.allocations
+                          << ", \"allocated_bytes\": " << measurement.allocated_bytes
+                          << ", \"peak_rss_kb\": " << peak_rss << "}" << std::endl;
+            else
+                std::cout << std::left << std::setw(10) << workload.name << std::setw(9) << api << std::right
+                          << std::setw(7) << measurement.files << std::fixed << std::setprecision(2)
+                          << std::setw(11) << megabytes << std::setw(11) << throughput << std::setw(11) << token_rate
+                          << std::setw(13) << measurement.allocations << std::setw(13) << peak_rss << std::endl;
+        }
+    }
+    return ok ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "tokenizer.h"
+#include "handler.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Scanner microbenchmark on deeply nested input, reporting the branch misses
+// of the scope transitions per structural token.
+// Usage: transitions [depth] [copies] [repetitions]
+
+namespace
+{
+    // Counts tokens without keeping them, so that scanning dominates
+    struct CountingHandler : ejson::TokenHandler
+    {
+        std::size_t tokens {0};
+        void onObjectBegin() override { ++tokens; }
+        void onObjectEnd() override { ++tokens; }
+        void onArrayBegin() override { ++tokens; }
+        void onArrayEnd() override { ++tokens; }
+        void onKey(ejson::StringView) override { ++tokens; }
+        void onString(ejson::StringView) override { ++tokens; }
+        void onNumber(ejson::StringView) override { ++tokens; }
+        void onLiteral(ejson::Token, ejson::StringView) override { ++tokens; }
+    };
+
+    // Hardware event counter of this thread, unavailable where perf events are not permitted
+    class Counter
+    {
+    private:
+        int _descriptor {-1};
+
+    public:
+        explicit Counter(unsigned long long config)
+        {
+#if defined(__linux__)
+            perf_event_attr attributes;
+            std::memset(&attributes, 0, sizeof(attributes));
+            attributes.size = sizeof(attributes);
+            attributes.type = PERF_TYPE_HARDWARE;
+            attributes.config = config;
+            attributes.disabled = 1;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            _descriptor = static_cast<int>(::syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0));
+#else
+            (void) config;
+#endif
+        }
+        ~Counter()
+        {
+#if defined(__linux__)
+            if(_descriptor >= 0)
+                ::close(_descriptor);
+#endif
+        }
+
+        bool available() const { return _descriptor >= 0; }
+        void start()
+        {
+#if defined(__linux__)
+            if(available())
+            {
+                ::ioctl(_descriptor, PERF_EVENT_IOC_RESET, 0);
+                ::ioctl(_descriptor, PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+        }
+        long long stop()
+        {
+            long long count {0};
+#if defined(__linux__)
+            if(available())
+            {
+                ::ioctl(_descriptor, PERF_EVENT_IOC_DISABLE, 0);
+                if(::read(_descriptor, &count, sizeof(count)) != sizeof(count))
+                    count = 0;
+            }
+#endif
+            return count;
+        }
+    };
+
+    // Object nesting arrays of objects, with a value of every kind on each level
+    void appendLevel(std::string &text, std::size_t depth)
+    {
+        if(depth == 0)
+        {
+            text += "\"k\": 1,\n";
+            return;
+        }
+        text += "\"k\": [ {";
+        appendLevel(text, depth - 1);
+        text += "}, 2, true, \"s\", [ 3, ], ],\n";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const std::size_t depth = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 200;
+    const std::size_t copies = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 200;
+    const std::size_t repetitions = (argc > 3) ? std::strtoul(argv[3], nullptr, 10) : 20;
+
+    std::string text;
+    for(std::size_t copy = 0; copy < copies; ++copy)
+    {
+        text += "{\n";
+        appendLevel(text, depth);
+        text += "}\n";
+    }
+    const std::string input_file {"./transitions-bench.ejson"};
+    std::ofstream{input_file, std::ios::binary} << text;
+
+    ejson::Tokenizer tokenizer{};
+    CountingHandler handler{};
+    Counter branch_misses{PERF_COUNT_HW_BRANCH_MISSES};
+    Counter branches{PERF_COUNT_HW_BRANCH_INSTRUCTIONS};
+
+    ejson::TokenizerFeedback feedback = tokenizer.tokenize(input_file, handler);
+    handler.tokens = 0;
+    auto begin = std::chrono::steady_clock::now();
+    branch_misses.start();
+    branches.start();
+    for(std::size_t repetition = 0; (repetition < repetitions) && (feedback.type == ejson::FeedbackType::OK); ++repetition)
+        feedback = tokenizer.tokenize(input_file, handler);
+    const long long branch_count = branches.stop();
+    const long long miss_count = branch_misses.stop();
+    auto end = std::chrono::steady_clock::now();
+    std::remove(input_file.c_str());
+
+    if(feedback.type != ejson::FeedbackType::OK)
+    {
+        std::cerr << "tokenization failed: " << feedback.snap << std::endl;
+        return 1;
+    }
+
+    const double seconds = std::chrono::duration<double>(end - begin).count();
+    const double bytes = static_cast<double>(text.size()) * repetitions;
+    std::cout << "depth " << depth << ", " << text.size() << " bytes, "
+              << handler.tokens / repetitions << " tokens" << std::endl;
+    std::cout << "throughput: " << bytes / seconds / 1e6 << " MB/s, "
+              << handler.tokens / seconds / 1e6 << " Mtokens/s" << std::endl;
+    if(branch_misses.available() && branches.available())
+        std::cout << "branches per token: " << static_cast<double>(branch_count) / handler.tokens << std::endl
+                  << "branch misses per token: " << static_cast<double>(miss_count) / handler.tokens << std::endl;
+    else
+        std::cout << "branch counters unavailable" << std::endl;
+    return 0;
+}
\ No newline at end of file
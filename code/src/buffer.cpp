@@ -0,0 +1,227 @@
+#include "buffer.h"
+#include <fstream>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define EJSON_HAS_MMAP 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace ejson
+{
+    // Files below this size are cheaper to read than to map
+    static const std::size_t MAP_THRESHOLD = 64 * 1024;
+
+    // Read contents are aligned like mapped ones, so that binary files can be used in place
+    static const std::size_t BLOCK_ALIGNMENT = alignof(std::max_align_t);
+
+#if defined(EJSON_HAS_MMAP)
+    static FileStamp stampOf(const struct stat &status)
+    {
+        FileStamp stamp {};
+        stamp.device = static_cast<std::uint64_t>(status.st_dev);
+        stamp.inode = static_cast<std::uint64_t>(status.st_ino);
+        stamp.size = static_cast<std::uint64_t>(status.st_size);
+#if defined(__APPLE__)
+        stamp.modified = static_cast<std::int64_t>(status.st_mtimespec.tv_sec) * 1000000000 + status.st_mtimespec.tv_nsec;
+#else
+        stamp.modified = static_cast<std::int64_t>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+#endif
+        return stamp;
+    }
+#endif
+
+    bool FileStamp::read(const char *path)
+    {
+#if defined(EJSON_HAS_MMAP)
+        struct stat status;
+        if((::stat(path, &status) != 0) || !S_ISREG(status.st_mode))
+            return false;
+
+        *this = stampOf(status);
+        return true;
+#else
+        // Without a way to tell file versions apart no two stamps are taken for equal
+        (void) path;
+        return false;
+#endif
+    }
+
+    bool FileStamp::read(int descriptor)
+    {
+#if defined(EJSON_HAS_MMAP)
+        struct stat status;
+        if((::fstat(descriptor, &status) != 0) || !S_ISREG(status.st_mode))
+            return false;
+
+        *this = stampOf(status);
+        return true;
+#else
+        (void) descriptor;
+        return false;
+#endif
+    }
+
+    FileBuffer::FileBuffer(FileBuffer &&other) noexcept
+        : _data{other._data},
+          _size{other._size},
+          _capacity{other._capacity},
+          _storage{other._storage},
+          _resource{other._resource},
+          _truncated{other._truncated},
+          _stamp{other._stamp}
+    {
+        other._data = nullptr;
+        other._size = 0;
+        other._capacity = 0;
+        other._storage = Storage::STORAGE_NONE;
+        other._resource = nullptr;
+        other._truncated = false;
+        other._stamp = FileStamp{};
+    }
+
+    FileBuffer &FileBuffer::operator=(FileBuffer &&other) noexcept
+    {
+        if(this != &other)
+        {
+            release();
+            std::swap(_data, other._data);
+            std::swap(_size, other._size);
+            std::swap(_capacity, other._capacity);
+            std::swap(_storage, other._storage);
+            std::swap(_resource, other._resource);
+            std::swap(_truncated, other._truncated);
+            std::swap(_stamp, other._stamp);
+        }
+        return *this;
+    }
+
+    FileBuffer::~FileBuffer()
+    {
+        release();
+    }
+
+    bool FileBuffer::load(const char *path, MemoryResource *resource, std::size_t limit)
+    {
+        release();
+#if defined(EJSON_HAS_MMAP)
+        int descriptor = ::open(path, O_RDONLY);
+        if(descriptor < 0)
+            return false;
+
+        bool success{false};
+        struct stat status;
+        if((::fstat(descriptor, &status) == 0) && S_ISREG(status.st_mode))
+        {
+            std::size_t size = static_cast<std::size_t>(status.st_size);
+            const bool truncated = (size > limit);
+            if(truncated)
+                size = limit;
+            if(!truncated && (size >= MAP_THRESHOLD))
+            {
+                void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+                if(mapping != MAP_FAILED)
+                {
+                    _data = static_cast<const char *>(mapping);
+                    _size = size;
+                    _storage = Storage::STORAGE_MAPPED;
+                    success = true;
+                }
+            }
+
+            // Files not mapped, e.g. on file systems without mmap support, are read instead
+            if(!success)
+            {
+                char *block = static_cast<char *>(resource->allocate(size + 1, BLOCK_ALIGNMENT));
+                std::size_t total{0};
+                ssize_t count{0};
+                while((total < size) && ((count = ::read(descriptor, block + total, size - total)) > 0))
+                    total += static_cast<std::size_t>(count);
+                if(count >= 0)
+                {
+                    _data = block;
+                    _size = total;
+                    _capacity = size + 1;
+                    _storage = Storage::STORAGE_HEAP;
+                    _resource = resource;
+                    _truncated = truncated;
+                    success = true;
+                }
+                else
+                    resource->deallocate(block, size + 1, BLOCK_ALIGNMENT);
+            }
+        }
+        if(success)
+            _stamp = stampOf(status);
+        ::close(descriptor);
+        return success;
+#else
+        std::ifstream stream{path, std::ios::binary | std::ios::ate};
+        if(stream.fail())
+            return false;
+
+        std::size_t size = static_cast<std::size_t>(stream.tellg());
+        _truncated = (size > limit);
+        if(_truncated)
+            size = limit;
+        char *block = static_cast<char *>(resource->allocate(size + 1, BLOCK_ALIGNMENT));
+        stream.seekg(0);
+        stream.read(block, static_cast<std::streamsize>(size));
+        _data = block;
+        _size = static_cast<std::size_t>(stream.gcount());
+        _capacity = size + 1;
+        _storage = Storage::STORAGE_HEAP;
+        _resource = resource;
+        return true;
+#endif
+    }
+
+    void FileBuffer::borrow(const char *data, std::size_t size, const FileStamp &stamp, std::size_t limit)
+    {
+        release();
+        _truncated = (size > limit);
+        _data = data;
+        _size = _truncated ? limit : size;
+        _storage = Storage::STORAGE_BORROWED;
+        _stamp = stamp;
+    }
+
+    char *FileBuffer::allocate(std::size_t size, MemoryResource *resource, const FileStamp &stamp)
+    {
+        release();
+        char *block = static_cast<char *>(resource->allocate(size + 1, BLOCK_ALIGNMENT));
+        _data = block;
+        _capacity = size + 1;
+        _storage = Storage::STORAGE_HEAP;
+        _resource = resource;
+        _stamp = stamp;
+        return block;
+    }
+
+    void FileBuffer::release()
+    {
+        switch (_storage)
+        {
+        case Storage::STORAGE_HEAP:
+            _resource->deallocate(const_cast<char *>(_data), _capacity, BLOCK_ALIGNMENT);
+            break;
+#if defined(EJSON_HAS_MMAP)
+        case Storage::STORAGE_MAPPED:
+            ::munmap(const_cast<char *>(_data), _size);
+            break;
+#endif
+        default:
+            break;
+        }
+        _data = nullptr;
+        _size = 0;
+        _capacity = 0;
+        _storage = Storage::STORAGE_NONE;
+        _resource = nullptr;
+        _truncated = false;
+        _stamp = FileStamp{};
+    }
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#ifndef EJSON_BUFFER_H
+#define EJSON_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include "memory.h"
+
+/* ejson library namespace */
+namespace ejson
+{
+
+    /* Identity and version of a file on disk, equal stamps are taken for equal contents */
+    struct FileStamp
+    {
+        std::uint64_t device {0};
+        std::uint64_t inode {0};
+        std::uint64_t size {0};
+        std::int64_t modified {0};
+
+        bool read(const char *);
+
+        // Stamp of an open file descriptor, where the platform has them
+        bool read(int);
+        bool operator==(const FileStamp &other) const
+        {
+            return (device == other.device) && (inode == other.inode) &&
+                   (size == other.size) && (modified == other.modified);
+        }
+        bool operator!=(const FileStamp &other) const { return !(*this == other); }
+    };
+
+    /* Read-only, contiguous contents of a complete eJSON file.
+       Large files are memory-mapped where the platform allows it,
+       smaller ones are read in a single call into a block of the given memory resource.
+       Contents held elsewhere, e.g. in memory by a file provider, are borrowed without a copy. */
+    class FileBuffer
+    {
+    private:
+        enum Storage
+        {
+            STORAGE_NONE,
+            STORAGE_HEAP,
+            STORAGE_MAPPED,
+            STORAGE_BORROWED
+        };
+        const char *_data {nullptr};
+        std::size_t _size {0};
+        std::size_t _capacity {0};
+        Storage _storage {Storage::STORAGE_NONE};
+        MemoryResource *_resource {nullptr};
+        bool _truncated {false};
+        FileStamp _stamp {};
+        void release();
+
+    public:
+        FileBuffer() = default;
+        FileBuffer(const FileBuffer &) = delete;
+        FileBuffer &operator=(const FileBuffer &) = delete;
+        FileBuffer(FileBuffer &&) noexcept;
+        FileBuffer &operator=(FileBuffer &&) noexcept;
+        ~FileBuffer();
+
+        // At most limit bytes are read, a truncated buffer holds a prefix of the file
+        bool load(const char *, MemoryResource * = newDeleteResource(),
+                  std::size_t limit = std::numeric_limits<std::size_t>::max());
+
+        // The contents must outlive the buffer and every token view into it
+        void borrow(const char *, std::size_t, const FileStamp & = FileStamp{},
+                    std::size_t limit = std::numeric_limits<std::size_t>::max());
+
+        // Room for contents of up to the given size read elsewhere, e.g. by the kernel in the
+        // background; the buffer is empty until fill() tells how many bytes were read
+        char *allocate(std::size_t, MemoryResource *, const FileStamp &);
+        void fill(std::size_t size) { _size = size; }
+        const char *begin() const { return _data; }
+        const char *end() const { return _data + _size; }
+        std::size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+        bool truncated() const { return _truncated; }
+
+        // Stamp of the file as it was when loading began
+        const FileStamp &stamp() const { return _stamp; }
+    };
+}
+
+#endif
\ No newline at end of file
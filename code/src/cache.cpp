@@ -0,0 +1,109 @@
+#include "cache.h"
+#include <utility>
+#include <iterator>
+
+namespace ejson
+{
+    // Approximate memory held by a cached file
+    static std::size_t footprint(const CachedFile &file)
+    {
+        std::size_t bytes = sizeof(CachedFile) + file.key.capacity();
+        for(const FileName &import_file : file.imports)
+            bytes += sizeof(FileName) + import_file.capacity();
+        bytes += file.pairs.capacity() * sizeof(TokenizedPair);
+        for(const TokenizedPair &pair : file.pairs)
+            bytes += pair.value.capacity();
+        return bytes;
+    }
+
+    TokenCache::TokenCache(std::size_t capacity) : _capacity{capacity}
+    {
+    }
+
+    std::shared_ptr<CachedFile> TokenCache::find(const std::string &key, const FileStamp &stamp)
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        auto search_result = _index.find(key);
+        if(search_result == std::end(_index))
+        {
+            ++_misses;
+            return nullptr;
+        }
+
+        Entries::iterator entry = search_result->second;
+        if(entry->file->stamp != stamp)
+        {
+            evict(entry);
+            ++_misses;
+            return nullptr;
+        }
+
+        // Most recently used files are kept at the front
+        _entries.splice(std::begin(_entries), _entries, entry);
+        ++_hits;
+        return entry->file;
+    }
+
+    bool TokenCache::contains(const std::string &key, const FileStamp &stamp) const
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        auto search_result = _index.find(key);
+        return (search_result != std::end(_index)) && (search_result->second->file->stamp == stamp);
+    }
+
+    void TokenCache::insert(std::shared_ptr<CachedFile> file)
+    {
+        const std::size_t bytes = footprint(*file);
+        std::lock_guard<std::mutex> lock{_mutex};
+        auto search_result = _index.find(file->key);
+        if(search_result != std::end(_index))
+            evict(search_result->second);
+        if(bytes > _capacity)
+            return;
+
+        while((_bytes + bytes) > _capacity)
+            evict(std::prev(std::end(_entries)));
+        _entries.emplace_front(Entry{file, bytes});
+        _index.emplace(file->key, std::begin(_entries));
+        _bytes += bytes;
+    }
+
+    void TokenCache::clear()
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _index.clear();
+        _entries.clear();
+        _bytes = 0;
+    }
+
+    void TokenCache::evict(Entries::iterator entry)
+    {
+        _bytes -= entry->bytes;
+        _index.erase(entry->file->key);
+        _entries.erase(entry);
+    }
+
+    std::size_t TokenCache::hits() const
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        return _hits;
+    }
+
+    std::size_t TokenCache::misses() const
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        return _misses;
+    }
+
+    std::size_t TokenCache::size() const
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        return _entries.size();
+    }
+
+    std::size_t TokenCache::bytes() const
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        return _bytes;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef EJSON_CACHE_H
+#define EJSON_CACHE_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+#include "tokenizer.h"
+
+/* ejson library namespace */
+namespace ejson
+{
+
+    /* Tokenized contents of one file as kept in a TokenCache.
+       Imports are kept as written in the import statements, relative to the file. */
+    struct CachedFile
+    {
+        std::string key {""};
+        FileStamp stamp {};
+        std::vector<FileName> imports {};
+        std::size_t body {0};
+        TokenizedPairs pairs {};
+        bool complete {false};
+    };
+
+    /* Tokenized files shared across tokenize() calls and tokenizers, see TokenizerOptions.
+       Files are looked up by their canonical path and reused only while their stamp is unchanged.
+       Memory is bounded: the least recently used files are evicted first. Thread-safe. */
+    class TokenCache
+    {
+    private:
+        struct Entry
+        {
+            std::shared_ptr<CachedFile> file;
+            std::size_t bytes;
+        };
+        typedef std::list<Entry> Entries;
+        std::size_t _capacity;
+        std::size_t _bytes {0};
+        std::size_t _hits {0};
+        std::size_t _misses {0};
+        Entries _entries {};
+        std::unordered_map<std::string, Entries::iterator> _index {};
+        mutable std::mutex _mutex {};
+        void evict(Entries::iterator);
+
+    public:
+        // Capacity in bytes of tokenized contents
+        explicit TokenCache(std::size_t capacity = 64 * 1024 * 1024);
+        TokenCache(const TokenCache &) = delete;
+        TokenCache &operator=(const TokenCache &) = delete;
+
+        // Complete file of the given key and stamp, a stale file is evicted
+        std::shared_ptr<CachedFile> find(const std::string &, const FileStamp &);
+
+        // Whether the file of the given key and stamp is held, not counted as a lookup
+        bool contains(const std::string &, const FileStamp &) const;
+        void insert(std::shared_ptr<CachedFile>);
+        void clear();
+
+        std::size_t hits() const;
+        std::size_t misses() const;
+        std::size_t size() const;
+        std::size_t bytes() const;
+    };
+}
+
+#endif
\ No newline at end of file
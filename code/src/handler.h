@@ -0,0 +1,34 @@
+#ifndef EJSON_HANDLER_H
+#define EJSON_HANDLER_H
+
+#include "tokenizer.h"
+
+/* ejson library namespace */
+namespace ejson
+{
+
+    /* Receiver of tokenization events, an alternative to collecting the tokens.
+       Events are delivered in import order, from the thread calling tokenize().
+       Values refer to the file being scanned and are valid for the duration of the call. */
+    class TokenHandler
+    {
+    public:
+        virtual ~TokenHandler() = default;
+
+        virtual void onFileBegin(StringView) {}
+        virtual void onFileEnd(StringView) {}
+        virtual void onObjectBegin() {}
+        virtual void onObjectEnd() {}
+        virtual void onArrayBegin() {}
+        virtual void onArrayEnd() {}
+        virtual void onKey(StringView) {}
+        virtual void onString(StringView) {}
+        virtual void onNumber(StringView) {}
+        // Numbers with their decoded value, passed on to onNumber() unless overridden
+        virtual void onNumberValue(StringView text, const Number &) { onNumber(text); }
+        // One of LITERAL_NULL, LITERAL_TRUE and LITERAL_FALSE
+        virtual void onLiteral(Token, StringView) {}
+    };
+}
+
+#endif
\ No newline at end of file
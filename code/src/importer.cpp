@@ -1,88 +1,339 @@
 #include "tokenizer.h"
+#include "scan.h"
+#include "cache.h"
+#include "provider.h"
+#include "readahead.h"
 #include <iostream>
 #include <algorithm>
 #include <limits>
 #include <cctype>
+#include <unordered_map>
 
 namespace ejson
 {
-    static const std::string IMPORT_STATEMENT = std::string{"import"};
+    static const StringView IMPORT_STATEMENT = StringView{"import", 6};
+    static const char *const CYCLE_SEPARATOR = " -> ";
 
-    void Tokenizer::initialize(const std::string &input_file,
+    // Size of the first read of a lazily loaded file, doubled until the import statements fit
+    static const std::size_t HEADER_PREFIX = 4096;
+
+    struct ArenaStringHash
+    {
+        std::size_t operator()(const ArenaString &value) const
+        {
+            // FNV-1a
+            std::uint64_t hash {14695981039346656037ull};
+            for(char c : value)
+                hash = (hash ^ (unsigned char) c) * 1099511628211ull;
+            return static_cast<std::size_t>(hash);
+        }
+    };
+    typedef std::unordered_map<ArenaString, std::size_t, ArenaStringHash, std::equal_to<ArenaString>,
+                               PolymorphicAllocator<std::pair<const ArenaString, std::size_t>>> FileIndex;
+
+    // Position in the import graph walk: a file and the next of its imports to visit
+    struct ImportFrame
+    {
+        std::size_t file;
+        ListOfFileNames imports;
+        std::size_t next;
+    };
+
+    TokenizerFeedback Tokenizer::resolve(const std::string &input_file, ImportGraph &import_graph)
+    {
+        const std::chrono::steady_clock::time_point begin = beginStatistics();
+        beginScratch(false);
+        ListOfFiles list_of_files{scratch()};
+        TokenizerFeedback feedback{};
+        const ArenaString root {input_file.data(), input_file.size(), scratch()};
+        initialize(&root, &root + 1, list_of_files, FileListener{}, feedback);
+
+        if(feedback.type == FeedbackType::OK)
+        {
+            std::for_each(std::begin(list_of_files),
+                          std::end(list_of_files),
+                          [&import_graph] (File const &file)
+            {
+                import_graph.files.emplace_back(FileName{file.path.data(), file.path.size()});
+                import_graph.imports.emplace_back(std::begin(file.imports), std::end(file.imports));
+            });
+        }
+
+        endStatistics(list_of_files, begin);
+        cleanup(list_of_files);
+        return feedback;
+    }
+
+    void Tokenizer::initialize(const ArenaString *first_root,
+                               const ArenaString *last_root,
                                ListOfFiles &list_of_files,
-                               TokenizerFeedback &feedback)
+                               const FileListener &listed,
+                               TokenizerFeedback &feedback,
+                               ArenaVector<std::size_t> *root_files)
     {
+        // Files already on the list are recognized by their canonical path.
+        // The graph is walked depth-first without recursion, listing every file
+        // before its imports, in the order of the import statements.
+        // The listener learns of each file as soon as its import statements are resolved.
+        // The graphs of several roots are walked one after the other into one list.
+        const bool collect = collecting();
+        const std::chrono::steady_clock::time_point begin = collect ? std::chrono::steady_clock::now()
+                                                                    : std::chrono::steady_clock::time_point{};
+        std::size_t imports {0};
+        std::size_t imports_deduplicated {0};
+        FileIndex index {0, ArenaStringHash{}, std::equal_to<ArenaString>{}, scratch()};
+        ArenaVector<ImportFrame> frames {scratch()};
+        ArenaVector<bool> visiting {PolymorphicAllocator<bool>{scratch()}};
+
+        // Imports not listed yet are read ahead while the walk goes on,
+        // unless the token cache holds them and they need not be read at all
+        auto read_ahead = [this, &index] (const ListOfFileNames &import_files)
+        {
+            for(const ArenaString &import_file : import_files)
+            {
+                const ArenaString canonical = canonicalPath(import_file);
+                if(index.count(canonical) > 0)
+                    continue;
+                FileStamp stamp {};
+                if((_options.token_cache != nullptr) && _provider->stamp(import_file.c_str(), stamp) &&
+                   _options.token_cache->contains(std::string{canonical.data(), canonical.size()}, stamp))
+                    continue;
+                _read_ahead->request(*_provider, import_file, _contents);
+            }
+        };
+
+        ListOfFileNames import_files {scratch()};
+        const ArenaString *next_root = first_root;
+        while(feedback.type == FeedbackType::OK)
+        {
+            if(frames.empty())
+            {
+                if(next_root == last_root)
+                    break;
+
+                // A root listed already, e.g. as an import of a root before, is not walked again
+                const ArenaString &input_file = *next_root++;
+                ArenaString canonical = canonicalPath(input_file);
+                auto search_result = index.find(canonical);
+                if(search_result != std::end(index))
+                {
+                    if(root_files != nullptr)
+                        root_files->push_back(search_result->second);
+                    continue;
+                }
+
+                const std::size_t root = list_of_files.size();
+                index.emplace(std::move(canonical), root);
+                if(root_files != nullptr)
+                    root_files->push_back(root);
+                import_files = ListOfFileNames{scratch()};
+                if(loadFile(input_file, list_of_files, import_files, feedback))
+                {
+                    frames.emplace_back(ImportFrame{root, std::move(import_files), 0});
+                    visiting.push_back(true);
+                    if(_read_ahead)
+                        read_ahead(frames.back().imports);
+                    if(listed)
+                        listed(list_of_files.back());
+                }
+                continue;
+            }
+
+            ImportFrame &frame = frames.back();
+            if(frame.next == frame.imports.size())
+            {
+                visiting[frame.file] = false;
+                frames.pop_back();
+                continue;
+            }
+
+            const std::size_t importer = frame.file;
+            const ArenaString import_file {std::move(frame.imports[frame.next++])};
+            ArenaString canonical = canonicalPath(import_file);
+            auto search_result = index.find(canonical);
+            ++imports;
+            if(search_result != std::end(index))
+            {
+                // Already listed, an import of a file still being walked closes a cycle
+                const std::size_t imported = search_result->second;
+                list_of_files[importer].imports.push_back(imported);
+                ++imports_deduplicated;
+                if(visiting[imported])
+                {
+                    feedback.type = FeedbackType::NOK_IMPORT_CYCLE;
+                    feedback.file.assign(list_of_files[importer].path.data(), list_of_files[importer].path.size());
+                    auto cycle_begin = std::find_if(std::begin(frames), std::end(frames),
+                                                    [imported] (ImportFrame const &cycle_frame)
+                                                    {
+                                                        return cycle_frame.file == imported;
+                                                    });
+                    std::for_each(cycle_begin, std::end(frames),
+                                  [&feedback, &list_of_files] (ImportFrame const &cycle_frame)
+                                  {
+                                      const ArenaString &path = list_of_files[cycle_frame.file].path;
+                                      feedback.snap.append(path.data(), path.size()).append(CYCLE_SEPARATOR);
+                                  });
+                    feedback.snap.append(list_of_files[imported].path.data(), list_of_files[imported].path.size());
+                }
+                continue;
+            }
+
+            const std::size_t imported = list_of_files.size();
+            index.emplace(std::move(canonical), imported);
+            list_of_files[importer].imports.push_back(imported);
+            import_files = ListOfFileNames{scratch()};
+            if(loadFile(import_file, list_of_files, import_files, feedback))
+            {
+                frames.emplace_back(ImportFrame{imported, std::move(import_files), 0});
+                visiting.push_back(true);
+                if(_read_ahead)
+                    read_ahead(frames.back().imports);
+                if(listed)
+                    listed(list_of_files.back());
+            }
+        }
+
+        // Files read ahead but not reached, e.g. after an error, are dropped
+        if(_read_ahead)
+            _read_ahead->clear();
 
-        // Proceed with initialization only if the file isn't already on the list
-        auto search_result = std::find_if( std::begin(list_of_files),
-                                        std::end(list_of_files),
-                                        [&input_file] (File const& file)
+        if(collect)
+        {
+            _options.statistics->resolve_time += nanosecondsSince(begin);
+            _options.statistics->imports += imports;
+            _options.statistics->imports_deduplicated += imports_deduplicated;
+        }
+    }
+
+    bool Tokenizer::loadFile(const ArenaString &input_file,
+                             ListOfFiles &list_of_files,
+                             ListOfFileNames &import_files,
+                             TokenizerFeedback &feedback)
+    {
+        // Get path to folder hosting the input file
+        std::size_t position = input_file.find_last_of( (char) Token::PATH_SEPARATOR,
+                                                        input_file.length());
+        if (position < input_file.length())
+        {
+            const ArenaString input_file_home {input_file, 0, (position + 1), scratch()};
+            
+            // Load the complete input file and add it to list
+            list_of_files.emplace_back( File
                                         {
-                                            return (input_file == file.path);
+                                            ArenaString{input_file, scratch()},
+                                            FileBuffer{},
+                                            0,
+                                            ArenaVector<std::size_t>{scratch()}
                                         });
+            
+            // Files found unchanged in the token cache are not read at all
+            File &file = list_of_files.back();
+            FileStamp stamp {};
+            if((_options.token_cache != nullptr) && _provider->stamp(input_file.c_str(), stamp))
+            {
+                const ArenaString canonical = canonicalPath(input_file);
+                std::string key {canonical.data(), canonical.size()};
+                file.cached = _options.token_cache->find(key, stamp);
+                if(!file.cached)
+                    file.cached = std::make_shared<CachedFile>(CachedFile{std::move(key), stamp});
+            }
 
-        if(search_result == std::end(list_of_files))
-        {
-            // Get path to folder hosting the input file
-            feedback.file = input_file;
-            std::size_t position = input_file.find_last_of( (char) Token::PATH_SEPARATOR,
-                                                            input_file.length());
-            if (position < input_file.length())
+            // Proceed further only if no file error is reported
+            if(file.cached && file.cached->complete)
             {
-                const std::string input_file_home = input_file.substr(0, (position + 1));
-                
-                // Open input stream for current input file and add it to list
-                list_of_files.emplace_back( File
-                                            {
-                                                input_file,
-                                                std::ifstream{input_file}
-                                            });
-                
-                // Proceed further only if no file error is reported
-                if(!list_of_files.back().stream.fail())
+                file.body = file.cached->body;
+                for(const FileName &import_file : file.cached->imports)
+                {
+                    import_files.emplace_back(input_file_home, input_file_home.get_allocator());
+                    import_files.back().append(import_file.data(), import_file.size());
+                }
+            }
+            else if(!_options.lazy_loading)
+            {
+                const std::chrono::steady_clock::time_point begin = collecting() ? std::chrono::steady_clock::now()
+                                                                                 : std::chrono::steady_clock::time_point{};
+                const bool loaded = (_read_ahead && _read_ahead->take(input_file, file.buffer)) ||
+                                    _provider->load(input_file.c_str(), file.buffer, _contents);
+                if(collecting())
+                    file.statistics.load_time += nanosecondsSince(begin);
+                if(loaded)
                 {
                     // Resolve names of files to be imported
-                    std::vector<std::string> import_files;
                     resolveImportStatements(    input_file_home,
-                                                list_of_files.back().stream,
+                                                file,
                                                 import_files,
                                                 feedback);
-                    if(feedback.type == FeedbackType::OK)
-                    {
-                        // Initialize tokenization for the imported files
-                        std::for_each(  std::begin(import_files),
-                                        std::end(import_files),
-                                        [this, &feedback, &list_of_files](std::string const &import_file)
-                                        {
-                                            // Initialization of next file is only continued
-                                            // if previous initialization was successful
-                                            if(feedback.type == FeedbackType::OK)
-                                                initialize(import_file, list_of_files, feedback);
-                                        });
-                    }
                 }
                 else
                     feedback.type = FeedbackType::NOK_FILE_ERROR;
             }
             else
-                feedback.type = FeedbackType::NOK_FILE_ERROR;
-        
-            // Clean up feedback before returning
-            if(feedback.type == FeedbackType::OK)
-                feedback.file = feedback.snap = std::string{""};
+            {
+                // Read a growing prefix until the import statements are complete,
+                // the file is loaded again when it is tokenized
+                std::size_t limit {HEADER_PREFIX};
+                bool loaded {false};
+                const std::chrono::steady_clock::time_point begin = collecting() ? std::chrono::steady_clock::now()
+                                                                                 : std::chrono::steady_clock::time_point{};
+                while((loaded = _provider->load(input_file.c_str(), file.buffer, _contents, limit)))
+                {
+                    resolveImportStatements(    input_file_home,
+                                                file,
+                                                import_files,
+                                                feedback);
+                    if(!file.buffer.truncated() || (file.body < file.buffer.size()) ||
+                       (feedback.type != FeedbackType::OK))
+                        break;
+                    import_files.clear();
+                    limit *= 2;
+                }
+                if(collecting())
+                    file.statistics.load_time += nanosecondsSince(begin);
+                if(!loaded)
+                    feedback.type = FeedbackType::NOK_FILE_ERROR;
+                file.buffer = FileBuffer{};
+            }
+
+            // The cache entry is completed once the file is tokenized
+            if(file.cached && !file.cached->complete && (feedback.type == FeedbackType::OK))
+            {
+                file.cached->body = file.body;
+                for(const ArenaString &import_file : import_files)
+                    file.cached->imports.emplace_back(import_file.data() + input_file_home.size(),
+                                                      import_file.size() - input_file_home.size());
+            }
         }
+        else
+            feedback.type = FeedbackType::NOK_FILE_ERROR;
+
+        // Errors found in this file are reported against it
+        if(feedback.type != FeedbackType::OK)
+            feedback.file.assign(input_file.data(), input_file.size());
+        return feedback.type == FeedbackType::OK;
     }
 
-    void Tokenizer::resolveImportStatements(const std::string &input_file_home,
-                                            std::ifstream &file,
-                                            std::vector<std::string> &import_files,
+    void Tokenizer::resolveImportStatements(const ArenaString &input_file_home,
+                                            File &file,
+                                            ListOfFileNames &import_files,
                                             TokenizerFeedback &feedback)
     {
-        
-        std::string line {""};
-        while(file.is_open() && !file.eof() && (feedback.type == FeedbackType::OK))
+        const char *position = file.buffer.begin();
+        const char *end = file.buffer.end();
+        file.body = file.buffer.size();
+
+        // Only complete lines of a truncated buffer are resolved
+        if(file.buffer.truncated())
+        {
+            while((end > position) && (*(end - 1) != (char) Token::NEW_LINE))
+                --end;
+        }
+        while((position < end) && (feedback.type == FeedbackType::OK))
         {
-            std::getline(file >> std::ws, line);
+            while((position < end) && isWhitespace(*position))
+                ++position;
+            const void *found = std::memchr(position, (char) Token::NEW_LINE, end - position);
+            const char *line_end = (found != nullptr) ? static_cast<const char *>(found) : end;
+            StringView line {position, static_cast<std::size_t>(line_end - position)};
             if(!line.empty())
             {
                 // Ignore the line if it is a comment
@@ -90,64 +341,58 @@ namespace ejson
                 // Assumption: import statements are always placed before object definitions
 
                 // Check for presence of comments in the line and remove them if found.
-                std::size_t first_comment_position = line.find_first_of((char) Token::COMMENT);
-                if(first_comment_position < line.npos)
-                    line.erase(first_comment_position);
+                const void *first_comment = std::memchr(line.data(), (char) Token::COMMENT, line.size());
+                if(first_comment != nullptr)
+                    line = StringView{line.data(), static_cast<std::size_t>(static_cast<const char *>(first_comment) - line.data())};
                 
                 if(!line.empty())
                 {
-                    if(line.front() != (char) ejson::Token::OBJECT_BEGIN)
+                    if(line[0] != (char) ejson::Token::OBJECT_BEGIN)
                         checkForAndParseImportStatement(    input_file_home,
                                                             line,
                                                             import_files,
                                                             feedback);
                     else
                     {
-                        line.push_back(Token::NEW_LINE);
-                        std::for_each(std::rbegin(line),
-                                      std::rend(line),
-                                      [&file](char const& c)
-                                      {
-                                          file.putback(c);
-                                      });
-                        file.setstate(std::ios_base::eofbit);
+                        // The file body is tokenized from here on
+                        file.body = position - file.buffer.begin();
+                        break;
                     }
                 }
             }
+            position = line_end;
         }
-
-        // Clear file stream state 
-        file.clear();
     }
 
-    void Tokenizer::checkForAndParseImportStatement(const std::string &input_file_home,
-                                                    const std::string &line,
-                                                    std::vector<std::string> &import_files,
+    void Tokenizer::checkForAndParseImportStatement(const ArenaString &input_file_home,
+                                                    StringView line,
+                                                    ListOfFileNames &import_files,
                                                     TokenizerFeedback &feedback)
     {
-        
-        feedback.snap = line;
-        std::stringstream stream {line};
-        std::string import_keyword {""};
-        std::string& import_file = import_keyword;
+        const char *end = line.end();
+        const char *separator = std::find(line.begin(), end, (char) Token::BLANK_SPACE);
+        const StringView import_keyword {line.data(), static_cast<std::size_t>(separator - line.data())};
         
         // Check and extract import statement
-        std::getline(stream, import_keyword, (char) Token::BLANK_SPACE);
-        if(!stream.eof() && (import_keyword == IMPORT_STATEMENT))
+        if((separator < end) && (import_keyword == IMPORT_STATEMENT))
         {
-            stream.ignore(std::numeric_limits<std::streamsize>::max(), (char) Token::STRING_DELIMITER);
-            if(!stream.eof())
+            const char *opening = std::find(separator + 1, end, (char) Token::STRING_DELIMITER);
+            const char *closing = (opening < end) ? std::find(opening + 1, end, (char) Token::STRING_DELIMITER) : end;
+            if(closing < end)
             {
-                std::getline(stream, import_file, (char) Token::STRING_DELIMITER);
-                if (!stream.eof() && !import_file.empty())
-                    import_files.emplace_back(std::string{input_file_home + import_file});
-                else if(stream.eof())
-                    feedback.type = FeedbackType::NOK_PARSER_ERROR;
+                if(closing > (opening + 1))
+                {
+                    import_files.emplace_back(input_file_home, input_file_home.get_allocator());
+                    import_files.back().append(opening + 1, closing);
+                }
             }
             else
                 feedback.type = FeedbackType::NOK_PARSER_ERROR;
         }
-        else if(!import_keyword.empty())
+        else
             feedback.type = FeedbackType::NOK_PARSER_ERROR;
+
+        if(feedback.type != FeedbackType::OK)
+            feedback.snap = line.str();
     }
 }
\ No newline at end of file
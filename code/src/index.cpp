@@ -0,0 +1,240 @@
+#include "tokenizer.h"
+#include "scan.h"
+#include "sink.h"
+#include <limits>
+#include <cstring>
+
+namespace ejson
+{
+    static void structureError(const char *begin, const char *position, const char *end, TokenizerFeedback &feedback)
+    {
+        feedback.type = FeedbackType::NOK_PARSER_ERROR;
+        feedback.snap = Cursor{begin, position + 1, end}.snap();
+    }
+
+    // Record the structure of the file body in one pass. Strings and comments are skipped whole,
+    // braces and brackets are matched as they close; values are not looked at.
+    static void indexStructure(const char *begin, const char *body, const char *end,
+                               StructuralIndex &index, ArenaVector<std::uint32_t> &open, TokenizerFeedback &feedback)
+    {
+        const char *p = body;
+        while((p = SCAN_KERNELS.findStructure(p, end)) < end)
+        {
+            const std::uint32_t entry = static_cast<std::uint32_t>(index.offsets.size());
+            switch (*p)
+            {
+            case (char) Token::STRING_DELIMITER:
+                p = SCAN_KERNELS.findQuote(p + 1, end);
+                if(p == end)
+                {
+                    structureError(begin, p - 1, end, feedback);
+                    return;
+                }
+                break;
+            case (char) Token::COMMENT:
+            {
+                const void *line_end = std::memchr(p, (char) Token::NEW_LINE, end - p);
+                p = (line_end != nullptr) ? static_cast<const char *>(line_end) : (end - 1);
+                break;
+            }
+            case (char) Token::OBJECT_BEGIN:
+            case (char) Token::ARRAY_BEGIN:
+                open.push_back(entry);
+                index.offsets.push_back(static_cast<std::uint32_t>(p - begin));
+                index.matches.push_back(entry);
+                break;
+            case (char) Token::OBJECT_END:
+            case (char) Token::ARRAY_END:
+            {
+                // Only the bracket of the same kind closes a container
+                const char opening = (*p == (char) Token::OBJECT_END) ? (char) Token::OBJECT_BEGIN : (char) Token::ARRAY_BEGIN;
+                if(open.empty() || (begin[index.offsets[open.back()]] != opening))
+                {
+                    structureError(begin, p, end, feedback);
+                    return;
+                }
+                index.matches[open.back()] = entry;
+                open.pop_back();
+                index.offsets.push_back(static_cast<std::uint32_t>(p - begin));
+                index.matches.push_back(entry);
+                break;
+            }
+            default:
+                index.offsets.push_back(static_cast<std::uint32_t>(p - begin));
+                index.matches.push_back(entry);
+                break;
+            }
+            ++p;
+        }
+        if(!open.empty())
+            structureError(begin, begin + index.offsets[open.back()], end, feedback);
+    }
+
+    TokenizerFeedback Tokenizer::index(const std::string &input_file,
+                                       ListOfStructuralIndexes &list_of_indexes)
+    {
+        // Initialize tokenization and index every file listed, as for zero-copy results:
+        // the file contents move into the indexes, which are allocated from the resource
+        // of the receiving container
+        const std::chrono::steady_clock::time_point begin = beginStatistics();
+        beginScratch(true);
+        ListOfFiles list_of_files{scratch()};
+        TokenizerFeedback feedback{};
+        MemoryResource *resource = list_of_indexes.get_allocator().resource();
+        std::deque<StructuralIndex, PolymorphicAllocator<StructuralIndex>> staged_indexes{scratch()};
+        const ArenaString root {input_file.data(), input_file.size(), scratch()};
+        std::size_t count = generateAll(&root, &root + 1,
+                                        list_of_files,
+                                        [this, &staged_indexes, resource] (File &file) -> FileTask
+        {
+            staged_indexes.emplace_back(StructuralIndex{ArenaString{file.path, resource},
+                                                        FileBuffer{},
+                                                        ArenaVector<std::uint32_t>{resource},
+                                                        ArenaVector<std::uint32_t>{resource}});
+            StructuralIndex &structural_index = staged_indexes.back();
+            return [this, &file, &structural_index] (Tokenizer &worker, TokenizerFeedback &file_feedback)
+            {
+                file_feedback.type = FeedbackType::OK;
+                if(openFile(file, file_feedback))
+                {
+                    if(file.buffer.size() <= std::numeric_limits<std::uint32_t>::max())
+                    {
+                        const std::chrono::steady_clock::time_point generate_begin = worker.collecting() ? std::chrono::steady_clock::now()
+                                                                                                        : std::chrono::steady_clock::time_point{};
+                        ArenaVector<std::uint32_t> open{worker.scratch()};
+                        indexStructure(file.buffer.begin(), file.buffer.begin() + file.body, file.buffer.end(),
+                                       structural_index, open, file_feedback);
+                        if(worker.collecting())
+                        {
+                            file.statistics.generate_time += nanosecondsSince(generate_begin);
+                            file.statistics.bytes = file.buffer.size();
+                        }
+                        structural_index.buffer = std::move(file.buffer);
+                    }
+                    else
+                        file_feedback.type = FeedbackType::NOK_FILE_ERROR;
+                    if(file_feedback.type != FeedbackType::OK)
+                        file_feedback.file.assign(file.path.data(), file.path.size());
+                }
+                closeFile(file);
+            };
+        }, feedback);
+        std::move(std::begin(staged_indexes), std::begin(staged_indexes) + count,
+                  std::back_inserter(list_of_indexes));
+
+        // Cleanup
+        endStatistics(list_of_files, begin);
+        cleanup(list_of_files);
+
+        return feedback;
+    }
+
+    // Key ending just before the colon of the given entry, keys hold no quotes; false if there is none
+    static bool keyOf(const StructuralIndex &index, std::size_t entry, StringView &key)
+    {
+        const char *begin = index.buffer.begin();
+        const char *closing = begin + index.offsets[entry];
+        while((closing > begin) && isWhitespace(*(closing - 1)))
+            --closing;
+        if((closing == begin) || (*(--closing) != (char) Token::STRING_DELIMITER))
+            return false;
+        const char *opening = closing;
+        while((opening > begin) && (*(opening - 1) != (char) Token::STRING_DELIMITER))
+            --opening;
+        key = StringView{opening, static_cast<std::size_t>(closing - opening)};
+        return opening > begin;
+    }
+
+    void Tokenizer::generateMember(const StructuralIndex &index, std::size_t entry, TokenSink &sink,
+                                   TokenizerFeedback &feedback)
+    {
+        // The member is scanned from its key on as within its object, until the scope returns to the object
+        feedback.type = FeedbackType::OK;
+        StringView key {};
+        keyOf(index, entry, key);
+        Scope scope{ScopeType::SCOPE_OBJECT, ScopeType::SCOPE_KEY};
+        Cursor cursor{index.buffer.begin(), key.begin(), index.buffer.end()};
+        _depth = 0;
+        pushStack(ScopeType::SCOPE_EMPTY);
+        pushStack(ScopeType::SCOPE_OBJECT);
+        const std::size_t depth = _depth;
+        do
+            scanStep(scope, cursor, sink, feedback);
+        while(!cursor.eof() && (feedback.type == FeedbackType::OK) &&
+              !((scope.current == ScopeType::SCOPE_OBJECT) && (_depth == depth)));
+
+        // Members cut short by the end of the file are in error as well
+        if((feedback.type == FeedbackType::OK) && (_depth != depth))
+        {
+            feedback.type = FeedbackType::NOK_PARSER_ERROR;
+            feedback.snap = cursor.snap();
+        }
+        if(feedback.type != FeedbackType::OK)
+            feedback.file.assign(index.path.data(), index.path.size());
+    }
+
+    TokenizerFeedback Tokenizer::query(const StructuralIndex &index,
+                                       const std::vector<std::string> &key_path,
+                                       ListOfTokenizedPairs &list_of_tokenized_pairs)
+    {
+        TokenizerFeedback feedback{};
+        if(key_path.empty() || (index.size() == 0) || (index.structure(0) != (char) Token::OBJECT_BEGIN))
+            return feedback;
+
+        // Objects holding the next key of the path, several if keys repeat. Members of an object
+        // are found by its colons; containers in between are skipped with their match.
+        ArenaVector<std::size_t> objects{_resource};
+        ArenaVector<std::size_t> found{_resource};
+        objects.push_back(0);
+        for(std::size_t segment = 0; segment < key_path.size(); ++segment)
+        {
+            const StringView key {key_path[segment].data(), key_path[segment].size()};
+            const bool last = (segment + 1 == key_path.size());
+            found.clear();
+            for(std::size_t object : objects)
+            {
+                for(std::size_t entry = object + 1; entry < index.matches[object]; entry = index.skip(entry))
+                {
+                    StringView member {};
+                    if((index.structure(entry) != (char) Token::KEY_END) || !keyOf(index, entry, member) || (member != key))
+                        continue;
+                    if(last)
+                        found.push_back(entry);
+                    else if((entry + 1 < index.matches[object]) && (index.structure(entry + 1) == (char) Token::OBJECT_BEGIN))
+                    {
+                        // The object must be the value of the key, not the next member
+                        Cursor cursor{index.buffer.begin(), index.buffer.begin() + index.offsets[entry] + 1, index.buffer.end()};
+                        if(cursor.skipWhitespace().position == index.buffer.begin() + index.offsets[entry + 1])
+                            found.push_back(entry + 1);
+                    }
+                }
+            }
+            objects.swap(found);
+        }
+
+        for(std::size_t entry : objects)
+        {
+            TokenizedPairs pairs = sparePairs();
+            PairsSink sink{pairs};
+            generateMember(index, entry, sink, feedback);
+            if(feedback.type != FeedbackType::OK)
+                break;
+            list_of_tokenized_pairs.push_back(std::move(pairs));
+        }
+        return feedback;
+    }
+
+    TokenizerFeedback Tokenizer::query(const ListOfStructuralIndexes &list_of_indexes,
+                                       const std::vector<std::string> &key_path,
+                                       ListOfTokenizedPairs &list_of_tokenized_pairs)
+    {
+        TokenizerFeedback feedback{};
+        for(const StructuralIndex &index : list_of_indexes)
+        {
+            feedback = query(index, key_path, list_of_tokenized_pairs);
+            if(feedback.type != FeedbackType::OK)
+                break;
+        }
+        return feedback;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "memory.h"
+#include <new>
+#include <cstdint>
+
+namespace ejson
+{
+    class NewDeleteResource : public MemoryResource
+    {
+    protected:
+        void *doAllocate(std::size_t bytes, std::size_t) override
+        {
+            return ::operator new(bytes);
+        }
+        void doDeallocate(void *pointer, std::size_t, std::size_t) override
+        {
+            ::operator delete(pointer);
+        }
+    };
+
+    MemoryResource *newDeleteResource()
+    {
+        static NewDeleteResource resource{};
+        return &resource;
+    }
+
+    MonotonicResource::MonotonicResource(std::size_t initial_size, MemoryResource *upstream)
+        : _upstream{upstream}, _next_size{(initial_size > 0) ? initial_size : 1}
+    {
+    }
+
+    MonotonicResource::MonotonicResource(void *buffer, std::size_t size, MemoryResource *upstream)
+        : _upstream{upstream},
+          _initial_buffer{buffer},
+          _initial_size{size},
+          _current{static_cast<char *>(buffer)},
+          _available{size},
+          _next_size{(size > 0) ? (2 * size) : 4096}
+    {
+    }
+
+    MonotonicResource::~MonotonicResource()
+    {
+        while(_chunks != nullptr)
+        {
+            Chunk *next = _chunks->next;
+            _upstream->deallocate(_chunks, _chunks->size, alignof(std::max_align_t));
+            _chunks = next;
+        }
+    }
+
+    void *MonotonicResource::doAllocate(std::size_t bytes, std::size_t alignment)
+    {
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(_current);
+        std::size_t padding = (alignment - (address % alignment)) % alignment;
+        if((_current == nullptr) || ((padding + bytes) > _available))
+        {
+            // Grow geometrically, a chunk always fits the request at hand
+            std::size_t size = sizeof(Chunk) + alignment + bytes;
+            if(size < _next_size)
+                size = _next_size;
+            Chunk *chunk = static_cast<Chunk *>(_upstream->allocate(size, alignof(std::max_align_t)));
+            chunk->next = _chunks;
+            chunk->size = size;
+            _chunks = chunk;
+            _current = reinterpret_cast<char *>(chunk + 1);
+            _available = size - sizeof(Chunk);
+            _next_size = 2 * size;
+
+            address = reinterpret_cast<std::uintptr_t>(_current);
+            padding = (alignment - (address % alignment)) % alignment;
+        }
+        void *pointer = _current + padding;
+        _current += padding + bytes;
+        _available -= padding + bytes;
+        return pointer;
+    }
+
+    void MonotonicResource::release()
+    {
+        // Keep the largest chunk, return all others upstream
+        Chunk *largest{nullptr};
+        while(_chunks != nullptr)
+        {
+            Chunk *next = _chunks->next;
+            if((largest == nullptr) || (_chunks->size > largest->size))
+            {
+                if(largest != nullptr)
+                    _upstream->deallocate(largest, largest->size, alignof(std::max_align_t));
+                largest = _chunks;
+            }
+            else
+                _upstream->deallocate(_chunks, _chunks->size, alignof(std::max_align_t));
+            _chunks = next;
+        }
+
+        if((largest != nullptr) && (largest->size - sizeof(Chunk) > _initial_size))
+        {
+            largest->next = nullptr;
+            _chunks = largest;
+            _current = reinterpret_cast<char *>(largest + 1);
+            _available = largest->size - sizeof(Chunk);
+        }
+        else
+        {
+            if(largest != nullptr)
+                _upstream->deallocate(largest, largest->size, alignof(std::max_align_t));
+            _current = static_cast<char *>(_initial_buffer);
+            _available = _initial_size;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,158 @@
+#ifndef EJSON_MEMORY_H
+#define EJSON_MEMORY_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstddef>
+
+/* ejson library namespace */
+namespace ejson
+{
+
+    /* Source of memory for containers and file contents,
+       following the interface of the C++17 std::pmr::memory_resource */
+    class MemoryResource
+    {
+    public:
+        virtual ~MemoryResource() = default;
+
+        void *allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t))
+        {
+            return doAllocate(bytes, alignment);
+        }
+        void deallocate(void *pointer, std::size_t bytes, std::size_t alignment = alignof(std::max_align_t))
+        {
+            doDeallocate(pointer, bytes, alignment);
+        }
+        bool isEqual(const MemoryResource &other) const noexcept
+        {
+            return doIsEqual(other);
+        }
+
+    protected:
+        virtual void *doAllocate(std::size_t, std::size_t) = 0;
+        virtual void doDeallocate(void *, std::size_t, std::size_t) = 0;
+        virtual bool doIsEqual(const MemoryResource &other) const noexcept
+        {
+            return this == &other;
+        }
+    };
+
+    // Resource forwarding to the global operator new and delete
+    MemoryResource *newDeleteResource();
+
+    /* Arena handing out memory from growing chunks; individual deallocations
+       are ignored and everything is returned at once with release() */
+    class MonotonicResource : public MemoryResource
+    {
+    private:
+        struct Chunk
+        {
+            Chunk *next;
+            std::size_t size;
+        };
+        MemoryResource *_upstream;
+        void *_initial_buffer {nullptr};
+        std::size_t _initial_size {0};
+        Chunk *_chunks {nullptr};
+        char *_current {nullptr};
+        std::size_t _available {0};
+        std::size_t _next_size;
+
+    protected:
+        void *doAllocate(std::size_t, std::size_t) override;
+        void doDeallocate(void *, std::size_t, std::size_t) override {}
+
+    public:
+        explicit MonotonicResource(std::size_t initial_size = 4096,
+                                   MemoryResource *upstream = newDeleteResource());
+        MonotonicResource(void *buffer, std::size_t size,
+                          MemoryResource *upstream = newDeleteResource());
+        MonotonicResource(const MonotonicResource &) = delete;
+        MonotonicResource &operator=(const MonotonicResource &) = delete;
+        ~MonotonicResource() override;
+
+        // Free everything handed out so far. The largest chunk is kept, chunks grow from one to
+        // the next, so after warm-up the largest chunk usually covers a repeated workload.
+        void release();
+        MemoryResource *upstream() const { return _upstream; }
+    };
+
+    /* Serializes access to an upstream resource, so that resources which are not
+       thread-safe themselves, e.g. MonotonicResource, can serve concurrent workers */
+    class SynchronizedResource : public MemoryResource
+    {
+    private:
+        MemoryResource *_upstream;
+        std::mutex _mutex {};
+
+    protected:
+        void *doAllocate(std::size_t bytes, std::size_t alignment) override
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            return _upstream->allocate(bytes, alignment);
+        }
+        void doDeallocate(void *pointer, std::size_t bytes, std::size_t alignment) override
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _upstream->deallocate(pointer, bytes, alignment);
+        }
+
+    public:
+        explicit SynchronizedResource(MemoryResource *upstream) : _upstream{upstream} {}
+        MemoryResource *upstream() const { return _upstream; }
+    };
+
+    /* Allocator adaptor drawing from a MemoryResource,
+       following the interface of the C++17 std::pmr::polymorphic_allocator */
+    template <typename T>
+    class PolymorphicAllocator
+    {
+    private:
+        MemoryResource *_resource;
+
+    public:
+        typedef T value_type;
+
+        PolymorphicAllocator() noexcept : _resource{newDeleteResource()} {}
+        PolymorphicAllocator(MemoryResource *resource) noexcept : _resource{resource} {}
+        template <typename U>
+        PolymorphicAllocator(const PolymorphicAllocator<U> &other) noexcept : _resource{other.resource()} {}
+
+        T *allocate(std::size_t count)
+        {
+            return static_cast<T *>(_resource->allocate(count * sizeof(T), alignof(T)));
+        }
+        void deallocate(T *pointer, std::size_t count)
+        {
+            _resource->deallocate(pointer, count * sizeof(T), alignof(T));
+        }
+        MemoryResource *resource() const noexcept { return _resource; }
+
+        // Copies of a container fall back to the default resource, as std::pmr does
+        PolymorphicAllocator select_on_container_copy_construction() const
+        {
+            return PolymorphicAllocator{};
+        }
+    };
+
+    template <typename T, typename U>
+    bool operator==(const PolymorphicAllocator<T> &a, const PolymorphicAllocator<U> &b) noexcept
+    {
+        return (a.resource() == b.resource()) || a.resource()->isEqual(*b.resource());
+    }
+
+    template <typename T, typename U>
+    bool operator!=(const PolymorphicAllocator<T> &a, const PolymorphicAllocator<U> &b) noexcept
+    {
+        return !(a == b);
+    }
+
+    /* Containers drawing from a MemoryResource */
+    template <typename T>
+    using ArenaVector = std::vector<T, PolymorphicAllocator<T>>;
+    typedef std::basic_string<char, std::char_traits<char>, PolymorphicAllocator<char>> ArenaString;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "tokenizer.h"
+#include "scan.h"
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#if defined(__GLIBC__) || defined(__APPLE__)
+#define EJSON_HAS_STRTOD_L 1
+#include <locale.h>
+#if defined(__APPLE__)
+#include <xlocale.h>
+#endif
+#endif
+
+namespace ejson
+{
+    // Mantissas of up to 19 decimal digits fit into 64 bits
+    static const std::size_t MAX_MANTISSA_DIGITS = 19;
+
+    // Decimal numbers with a mantissa and a power of ten within these bounds
+    // are exact as doubles, so that one multiplication or division rounds them correctly
+    static const std::uint64_t MAX_EXACT_MANTISSA = std::uint64_t{1} << 53;
+    static const int MAX_EXACT_EXPONENT = 22;
+    static const double EXACT_POWERS_OF_TEN[MAX_EXACT_EXPONENT + 1] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    // Exponents beyond this bound over- or underflow any double
+    static const int MAX_EXPONENT = 100000;
+
+    // Numbers up to this length are converted by strtod_l from a copy on the stack
+    static const std::size_t MAX_STACK_COPY = 128;
+
+    static int hexadecimalDigit(char c)
+    {
+        if((c >= '0') && (c <= '9'))
+            return c - '0';
+        if((c >= 'a') && (c <= 'f'))
+            return c - 'a' + 10;
+        if((c >= 'A') && (c <= 'F'))
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    // Integers that fit into int64_t are signed, larger positive ones unsigned
+    static bool integerNumber(bool negative, std::uint64_t magnitude, Number &number)
+    {
+        const std::uint64_t max_integer = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+        if(negative)
+        {
+            if(magnitude > max_integer + 1)
+                return false;
+            number.type = NumberType::NUMBER_INTEGER;
+            number.integer = (magnitude == max_integer + 1) ? std::numeric_limits<std::int64_t>::min()
+                                                            : -static_cast<std::int64_t>(magnitude);
+        }
+        else if(magnitude > max_integer)
+        {
+            number.type = NumberType::NUMBER_UNSIGNED;
+            number.unsigned_integer = magnitude;
+        }
+        else
+        {
+            number.type = NumberType::NUMBER_INTEGER;
+            number.integer = static_cast<std::int64_t>(magnitude);
+        }
+        return true;
+    }
+
+    // Correctly rounded conversion independent of the global locale, for numbers off the fast path
+    static double slowReal(StringView text)
+    {
+#if defined(EJSON_HAS_STRTOD_L)
+        if(text.size() < MAX_STACK_COPY)
+        {
+            static const locale_t c_locale = ::newlocale(LC_ALL_MASK, "C", static_cast<locale_t>(0));
+            char copy[MAX_STACK_COPY];
+            std::memcpy(copy, text.data(), text.size());
+            copy[text.size()] = '\0';
+            return ::strtod_l(copy, nullptr, c_locale);
+        }
+#endif
+        std::istringstream stream{text.str()};
+        stream.imbue(std::locale::classic());
+        double real {0.0};
+        stream >> real;
+        return real;
+    }
+
+    bool decodeNumber(StringView text, Number &number)
+    {
+        const char *position = text.begin();
+        const char *end = text.end();
+        const bool negative = (position < end) && (*position == '-');
+        if(negative)
+            ++position;
+
+        // Hexadecimal integers, e.g. register addresses
+        if(((end - position) > 2) && (position[0] == '0') && ((position[1] == 'x') || (position[1] == 'X')))
+        {
+            std::uint64_t magnitude {0};
+            for(position += 2; position < end; ++position)
+            {
+                const int digit = hexadecimalDigit(*position);
+                if((digit < 0) || (magnitude >> 60) != 0)
+                    return false;
+                magnitude = (magnitude << 4) | static_cast<std::uint64_t>(digit);
+            }
+            return integerNumber(negative, magnitude, number);
+        }
+
+        // Integer part, as an exact integer while it fits
+        const char *digits = position;
+        std::uint64_t magnitude {0};
+        bool exact {true};
+        std::uint64_t mantissa {0};
+        std::size_t significant {0};
+        int exponent {0};
+        bool truncated {false};
+        for(; (position < end) && isDigit(*position); ++position)
+        {
+            const std::uint64_t digit = static_cast<std::uint64_t>(*position - '0');
+            if(exact && (magnitude > (std::numeric_limits<std::uint64_t>::max() - digit) / 10))
+                exact = false;
+            magnitude = magnitude * 10 + digit;
+            if(significant < MAX_MANTISSA_DIGITS)
+            {
+                mantissa = mantissa * 10 + digit;
+                significant += (mantissa != 0) ? 1 : 0;
+            }
+            else
+            {
+                ++exponent;
+                truncated = truncated || (digit != 0);
+            }
+        }
+        // A leading zero is the whole integer part, e.g. 0.5 but not 007 or 00.5
+        if((position == digits) || ((*digits == '0') && (position - digits > 1)))
+            return false;
+
+        // Fraction and exponent make a real number
+        bool integral {true};
+        if((position < end) && (*position == '.'))
+        {
+            integral = false;
+            const char *fraction = ++position;
+            for(; (position < end) && isDigit(*position); ++position)
+            {
+                const std::uint64_t digit = static_cast<std::uint64_t>(*position - '0');
+                if(significant < MAX_MANTISSA_DIGITS)
+                {
+                    mantissa = mantissa * 10 + digit;
+                    significant += (mantissa != 0) ? 1 : 0;
+                    --exponent;
+                }
+                else
+                    truncated = truncated || (digit != 0);
+            }
+            if(position == fraction)
+                return false;
+        }
+        if((position < end) && ((*position == 'e') || (*position == 'E')))
+        {
+            integral = false;
+            ++position;
+            const bool negative_exponent = (position < end) && (*position == '-');
+            if((position < end) && ((*position == '-') || (*position == '+')))
+                ++position;
+            const char *exponent_digits = position;
+            int explicit_exponent {0};
+            for(; (position < end) && isDigit(*position); ++position)
+            {
+                if(explicit_exponent < MAX_EXPONENT)
+                    explicit_exponent = explicit_exponent * 10 + (*position - '0');
+            }
+            if(position == exponent_digits)
+                return false;
+            exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+        }
+        if(position != end)
+            return false;
+
+        if(integral && exact && integerNumber(negative, magnitude, number))
+            return true;
+
+        number.type = NumberType::NUMBER_REAL;
+        if(!truncated && (mantissa <= MAX_EXACT_MANTISSA) &&
+           (exponent >= -MAX_EXACT_EXPONENT) && (exponent <= MAX_EXACT_EXPONENT))
+        {
+            const double real = static_cast<double>(mantissa);
+            number.real = (exponent < 0) ? (real / EXACT_POWERS_OF_TEN[-exponent]) : (real * EXACT_POWERS_OF_TEN[exponent]);
+            if(negative)
+                number.real = -number.real;
+        }
+        else
+            number.real = slowReal(text);
+        return true;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,307 @@
+#include "provider.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+namespace ejson
+{
+    static const StringView CURRENT_SEGMENT = StringView{".", 1};
+    static const StringView PARENT_SEGMENT = StringView{"..", 2};
+
+    // Stamps of files held in memory name no device, every version of a file gets an inode of its own.
+    // Versions are counted per process, the time the process first took one tells processes apart,
+    // so that stamps kept on a token tape never match those of another process.
+    static const std::uint64_t MEMORY_DEVICE = std::numeric_limits<std::uint64_t>::max();
+
+    static FileStamp memoryStamp(std::size_t size)
+    {
+        static std::atomic<std::uint64_t> versions {0};
+        static const std::int64_t process = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        FileStamp stamp {};
+        stamp.device = MEMORY_DEVICE;
+        stamp.inode = ++versions;
+        stamp.size = size;
+        stamp.modified = process;
+        return stamp;
+    }
+
+    ArenaString canonicalPath(const ArenaString &path)
+    {
+        ArenaString canonical {path.get_allocator()};
+        canonical.reserve(path.size());
+        const bool absolute = !path.empty() && (path.front() == (char) Token::PATH_SEPARATOR);
+        std::size_t kept {0};
+        std::size_t begin {0};
+        while(begin <= path.size())
+        {
+            std::size_t end = path.find((char) Token::PATH_SEPARATOR, begin);
+            if(end == path.npos)
+                end = path.size();
+            const StringView segment {path.data() + begin, end - begin};
+            if(segment == PARENT_SEGMENT && (kept > 0))
+            {
+                // Drop the last kept segment
+                std::size_t last = canonical.find_last_of((char) Token::PATH_SEPARATOR);
+                canonical.erase((last == canonical.npos) ? 0 : last);
+                --kept;
+            }
+            else if(!segment.empty() && (segment != CURRENT_SEGMENT) && !(segment == PARENT_SEGMENT && absolute))
+            {
+                if(!canonical.empty() || absolute)
+                    canonical.push_back((char) Token::PATH_SEPARATOR);
+                canonical.append(segment.data(), segment.size());
+                if(segment != PARENT_SEGMENT)
+                    ++kept;
+            }
+            begin = end + 1;
+        }
+        if(canonical.empty() && absolute)
+            canonical.push_back((char) Token::PATH_SEPARATOR);
+        return canonical;
+    }
+
+    /* The root file given by its contents, every other file is loaded from the provider in use */
+    class RootProvider : public FileProvider
+    {
+    private:
+        const std::string &_path;
+        StringView _contents;
+        const FileProvider &_imports;
+
+    public:
+        RootProvider(const std::string &path, StringView contents, const FileProvider &imports)
+            : _path{path}, _contents{contents}, _imports{imports}
+        {
+        }
+
+        bool load(const char *path, FileBuffer &buffer, MemoryResource *resource, std::size_t limit) const override
+        {
+            // Other names of the root file are recognized as imports of it before loading
+            if(_path != path)
+                return _imports.load(path, buffer, resource, limit);
+            buffer.borrow(_contents.data(), _contents.size(), FileStamp{}, limit);
+            return true;
+        }
+
+        // The root file is not cached, its contents may change from call to call
+        bool stamp(const char *path, FileStamp &stamp) const override
+        {
+            return (_path != path) && _imports.stamp(path, stamp);
+        }
+    };
+
+    TokenizerFeedback Tokenizer::tokenize(const std::string &input_file,
+                                          StringView contents,
+                                          ListOfTokenizedPairs &list_of_tokenized_pairs)
+    {
+        return withRootContents(input_file, contents, [this, &input_file, &list_of_tokenized_pairs] ()
+        {
+            return tokenize(input_file, list_of_tokenized_pairs);
+        });
+    }
+
+    TokenizerFeedback Tokenizer::tokenize(const std::string &input_file,
+                                          StringView contents,
+                                          ListOfTokenizedFiles &list_of_tokenized_files)
+    {
+        return withRootContents(input_file, contents, [this, &input_file, &list_of_tokenized_files] ()
+        {
+            return tokenize(input_file, list_of_tokenized_files);
+        });
+    }
+
+    TokenizerFeedback Tokenizer::tokenize(const std::string &input_file,
+                                          StringView contents,
+                                          ListOfTokenColumns &list_of_token_columns)
+    {
+        return withRootContents(input_file, contents, [this, &input_file, &list_of_token_columns] ()
+        {
+            return tokenize(input_file, list_of_token_columns);
+        });
+    }
+
+    TokenizerFeedback Tokenizer::tokenize(const std::string &input_file,
+                                          StringView contents,
+                                          TokenHandler &handler)
+    {
+        return withRootContents(input_file, contents, [this, &input_file, &handler] ()
+        {
+            return tokenize(input_file, handler);
+        });
+    }
+
+    TokenizerFeedback Tokenizer::withRootContents(const std::string &input_file,
+                                                  StringView contents,
+                                                  const std::function<TokenizerFeedback()> &tokenize_files)
+    {
+        // The root provider stands in for the provider in use for the duration of the call,
+        // which is put back also if the call throws
+        struct ProviderRestore
+        {
+            const FileProvider *&slot;
+            const FileProvider *provider;
+            ~ProviderRestore() { slot = provider; }
+        };
+        const ProviderRestore restore {_provider, _provider};
+        const RootProvider root_provider {input_file, contents, *restore.provider};
+        _provider = &root_provider;
+        return tokenize_files();
+    }
+
+    bool FileSystemProvider::load(const char *path, FileBuffer &buffer, MemoryResource *resource, std::size_t limit) const
+    {
+        return buffer.load(path, resource, limit);
+    }
+
+    bool FileSystemProvider::stamp(const char *path, FileStamp &stamp) const
+    {
+        return stamp.read(path);
+    }
+
+    FileProvider *fileSystemProvider()
+    {
+        static FileSystemProvider provider {};
+        return &provider;
+    }
+
+    const MemoryProvider::Entry *MemoryProvider::find(const char *path) const
+    {
+        const ArenaString canonical = canonicalPath(ArenaString{path});
+        auto search_result = _files.find(std::string{canonical.data(), canonical.size()});
+        return (search_result != std::end(_files)) ? &search_result->second : nullptr;
+    }
+
+    void MemoryProvider::add(const std::string &path, std::string contents)
+    {
+        const ArenaString canonical = canonicalPath(ArenaString{path.data(), path.size()});
+        Entry &entry = _files[std::string{canonical.data(), canonical.size()}];
+        entry.contents = std::move(contents);
+        // The view is taken once the contents are in place
+        entry.view = StringView{entry.contents.data(), entry.contents.size()};
+        entry.stamp = memoryStamp(entry.view.size());
+    }
+
+    void MemoryProvider::borrow(const std::string &path, StringView contents)
+    {
+        const ArenaString canonical = canonicalPath(ArenaString{path.data(), path.size()});
+        Entry &entry = _files[std::string{canonical.data(), canonical.size()}];
+        entry.contents.clear();
+        entry.view = contents;
+        entry.stamp = memoryStamp(contents.size());
+    }
+
+    void MemoryProvider::remove(const std::string &path)
+    {
+        const ArenaString canonical = canonicalPath(ArenaString{path.data(), path.size()});
+        _files.erase(std::string{canonical.data(), canonical.size()});
+    }
+
+    void MemoryProvider::clear()
+    {
+        _files.clear();
+    }
+
+    bool MemoryProvider::load(const char *path, FileBuffer &buffer, MemoryResource *, std::size_t limit) const
+    {
+        const Entry *entry = find(path);
+        if(entry == nullptr)
+            return false;
+
+        buffer.borrow(entry->view.data(), entry->view.size(), entry->stamp, limit);
+        return true;
+    }
+
+    bool MemoryProvider::stamp(const char *path, FileStamp &stamp) const
+    {
+        const Entry *entry = find(path);
+        if(entry == nullptr)
+            return false;
+
+        stamp = entry->stamp;
+        return true;
+    }
+
+    /* Layout of the 512-byte header blocks of ustar archives, numbers are octal text */
+    static const std::size_t TAR_BLOCK = 512;
+    static const std::size_t TAR_NAME = 0;
+    static const std::size_t TAR_NAME_LENGTH = 100;
+    static const std::size_t TAR_SIZE = 124;
+    static const std::size_t TAR_SIZE_LENGTH = 12;
+    static const std::size_t TAR_CHECKSUM = 148;
+    static const std::size_t TAR_CHECKSUM_LENGTH = 8;
+    static const std::size_t TAR_TYPE = 156;
+    static const std::size_t TAR_MAGIC = 257;
+    static const std::size_t TAR_PREFIX = 345;
+    static const std::size_t TAR_PREFIX_LENGTH = 155;
+    static const StringView USTAR_MAGIC = StringView{"ustar", 5};
+
+    static bool octalField(const char *field, std::size_t length, std::uint64_t &value)
+    {
+        value = 0;
+        std::size_t index {0};
+        while((index < length) && (field[index] == ' '))
+            ++index;
+        for(; (index < length) && (field[index] >= '0') && (field[index] <= '7'); ++index)
+        {
+            if(value > (std::numeric_limits<std::uint64_t>::max() >> 3))
+                return false;
+            value = (value << 3) | static_cast<std::uint64_t>(field[index] - '0');
+        }
+        // Numbers end with a space or NUL
+        return (index == length) || (field[index] == ' ') || (field[index] == '\0');
+    }
+
+    static StringView textField(const char *field, std::size_t length)
+    {
+        const void *found = std::memchr(field, '\0', length);
+        return StringView{field, (found != nullptr) ? static_cast<std::size_t>(static_cast<const char *>(found) - field) : length};
+    }
+
+    bool ArchiveProvider::open(const char *data, std::size_t size)
+    {
+        // Headers are checked by their checksum, the archive ends with a zero block or its data
+        std::size_t offset {0};
+        while(offset + TAR_BLOCK <= size)
+        {
+            const char *header = data + offset;
+            std::uint64_t checksum {0};
+            std::uint64_t file_size {0};
+            if(header[TAR_NAME] == '\0')
+                return true;
+            if(!octalField(header + TAR_CHECKSUM, TAR_CHECKSUM_LENGTH, checksum) ||
+               !octalField(header + TAR_SIZE, TAR_SIZE_LENGTH, file_size))
+                return false;
+
+            // Sum of the header bytes, with the checksum field taken as spaces
+            std::uint64_t sum {0};
+            for(std::size_t index = 0; index < TAR_BLOCK; ++index)
+                sum += ((index >= TAR_CHECKSUM) && (index < TAR_CHECKSUM + TAR_CHECKSUM_LENGTH)) ?
+                       static_cast<unsigned char>(' ') : static_cast<unsigned char>(header[index]);
+            if(sum != checksum)
+                return false;
+
+            offset += TAR_BLOCK;
+            if(file_size > size - offset)
+                return false;
+
+            const char type = header[TAR_TYPE];
+            if((type == '0') || (type == '\0'))
+            {
+                std::string path {};
+                if(StringView{header + TAR_MAGIC, USTAR_MAGIC.size()} == USTAR_MAGIC)
+                {
+                    const StringView prefix = textField(header + TAR_PREFIX, TAR_PREFIX_LENGTH);
+                    if(!prefix.empty())
+                        path.append(prefix.data(), prefix.size()).push_back((char) Token::PATH_SEPARATOR);
+                }
+                const StringView name = textField(header + TAR_NAME, TAR_NAME_LENGTH);
+                path.append(name.data(), name.size());
+                borrow(path, StringView{data + offset, static_cast<std::size_t>(file_size)});
+            }
+            offset += static_cast<std::size_t>((file_size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK);
+        }
+        return offset >= size;
+    }
+}
\ No newline at end of file
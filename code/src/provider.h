@@ -0,0 +1,92 @@
+#ifndef EJSON_PROVIDER_H
+#define EJSON_PROVIDER_H
+
+#include <string>
+#include <unordered_map>
+#include <cstddef>
+#include <limits>
+#include "tokenizer.h"
+#include "buffer.h"
+
+/* ejson library namespace */
+namespace ejson
+{
+
+    // Lexically normalized form of a path, e.g. "sub/../a.ejson" for "./a.ejson" is "a.ejson"
+    ArenaString canonicalPath(const ArenaString &);
+
+    /* Source of the contents of eJSON files, see TokenizerOptions.
+       Files are named by the paths the tokenizer builds from import statements,
+       relative to the folder of the importing file. Files are loaded concurrently
+       by the workers of a tokenizer, so loading must be thread-safe. */
+    class FileProvider
+    {
+    public:
+        virtual ~FileProvider() = default;
+
+        // Contents of the file, of at most limit bytes; false if there is no such file
+        virtual bool load(const char *, FileBuffer &, MemoryResource *,
+                          std::size_t limit = std::numeric_limits<std::size_t>::max()) const = 0;
+
+        // Version of the file for the token cache; false if versions cannot be told apart
+        virtual bool stamp(const char *, FileStamp &) const = 0;
+    };
+
+    /* Files on disk, the provider in use by default */
+    class FileSystemProvider : public FileProvider
+    {
+    public:
+        bool load(const char *, FileBuffer &, MemoryResource *,
+                  std::size_t limit = std::numeric_limits<std::size_t>::max()) const override;
+        bool stamp(const char *, FileStamp &) const override;
+    };
+
+    // Provider shared by all tokenizers without a provider of their own
+    FileProvider *fileSystemProvider();
+
+    /* Files held in memory by their canonical path. Their contents are borrowed
+       by the buffers loaded, they must not be replaced while tokenizing. */
+    class MemoryProvider : public FileProvider
+    {
+    private:
+        struct Entry
+        {
+            std::string contents;
+            StringView view;
+            FileStamp stamp;
+        };
+        std::unordered_map<std::string, Entry> _files {};
+        const Entry *find(const char *) const;
+
+    public:
+        MemoryProvider() = default;
+        MemoryProvider(const MemoryProvider &) = delete;
+        MemoryProvider &operator=(const MemoryProvider &) = delete;
+
+        // Keep a copy of the contents
+        void add(const std::string &, std::string);
+
+        // Refer to contents that outlive the provider, e.g. data embedded in the binary
+        void borrow(const std::string &, StringView);
+
+        void remove(const std::string &);
+        void clear();
+        std::size_t size() const { return _files.size(); }
+
+        bool load(const char *, FileBuffer &, MemoryResource *,
+                  std::size_t limit = std::numeric_limits<std::size_t>::max()) const override;
+        bool stamp(const char *, FileStamp &) const override;
+    };
+
+    /* Files of a tar archive in memory, e.g. embedded in the binary or fetched as one blob.
+       Regular files of ustar archives are served in place, other entries are ignored.
+       The archive must outlive the provider and every buffer loaded from it. */
+    class ArchiveProvider : public MemoryProvider
+    {
+    public:
+        // Fails for malformed archives, files of the archive are added to those held
+        bool open(const char *, std::size_t);
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,354 @@
+#include "readahead.h"
+#include "provider.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+// io_uring is set up with raw system calls, kernels from 5.7 on read regular files through it
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined(IORING_FEAT_FAST_POLL)
+#define EJSON_HAS_IO_URING 1
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+#endif
+
+namespace ejson
+{
+    // Largest single read, larger files are read on from where the read before ended
+    static const std::size_t MAX_READ = 1u << 30;
+
+    // Largest number of reads in flight through io_uring
+    static const std::size_t MAX_RING_DEPTH = 4096;
+
+#if defined(EJSON_HAS_IO_URING)
+    /* Submission and completion queues shared with the kernel. Entries are submitted one
+       at a time as they are queued, the kernel reads the queue only while being entered. */
+    struct ReadAhead::Ring
+    {
+        int descriptor {-1};
+        unsigned capacity {0};
+        void *submission {MAP_FAILED};
+        std::size_t submission_size {0};
+        void *completion {MAP_FAILED};
+        std::size_t completion_size {0};
+        void *entries {MAP_FAILED};
+        std::size_t entries_size {0};
+        unsigned *submission_tail {nullptr};
+        unsigned *submission_mask {nullptr};
+        unsigned *submission_array {nullptr};
+        unsigned *completion_head {nullptr};
+        unsigned *completion_tail {nullptr};
+        unsigned *completion_mask {nullptr};
+        io_uring_cqe *completions {nullptr};
+
+        Ring() = default;
+        Ring(const Ring &) = delete;
+        Ring &operator=(const Ring &) = delete;
+
+        ~Ring()
+        {
+            if(entries != MAP_FAILED)
+                ::munmap(entries, entries_size);
+            if((completion != MAP_FAILED) && (completion != submission))
+                ::munmap(completion, completion_size);
+            if(submission != MAP_FAILED)
+                ::munmap(submission, submission_size);
+            if(descriptor >= 0)
+                ::close(descriptor);
+        }
+
+        bool setup(unsigned depth)
+        {
+            io_uring_params parameters {};
+            descriptor = static_cast<int>(::syscall(__NR_io_uring_setup, depth, &parameters));
+            if(descriptor < 0)
+                return false;
+            capacity = parameters.sq_entries;
+
+            // Both queues share one mapping where the kernel allows it
+            submission_size = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned);
+            completion_size = parameters.cq_off.cqes + parameters.cq_entries * sizeof(io_uring_cqe);
+            const bool single_mapping = (parameters.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if(single_mapping)
+                submission_size = completion_size = std::max(submission_size, completion_size);
+            submission = ::mmap(nullptr, submission_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                descriptor, IORING_OFF_SQ_RING);
+            if(submission == MAP_FAILED)
+                return false;
+            completion = single_mapping ? submission
+                                        : ::mmap(nullptr, completion_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                                 descriptor, IORING_OFF_CQ_RING);
+            if(completion == MAP_FAILED)
+                return false;
+            entries_size = parameters.sq_entries * sizeof(io_uring_sqe);
+            entries = ::mmap(nullptr, entries_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             descriptor, IORING_OFF_SQES);
+            if(entries == MAP_FAILED)
+                return false;
+
+            char *submission_ring = static_cast<char *>(submission);
+            char *completion_ring = static_cast<char *>(completion);
+            submission_tail = reinterpret_cast<unsigned *>(submission_ring + parameters.sq_off.tail);
+            submission_mask = reinterpret_cast<unsigned *>(submission_ring + parameters.sq_off.ring_mask);
+            submission_array = reinterpret_cast<unsigned *>(submission_ring + parameters.sq_off.array);
+            completion_head = reinterpret_cast<unsigned *>(completion_ring + parameters.cq_off.head);
+            completion_tail = reinterpret_cast<unsigned *>(completion_ring + parameters.cq_off.tail);
+            completion_mask = reinterpret_cast<unsigned *>(completion_ring + parameters.cq_off.ring_mask);
+            completions = reinterpret_cast<io_uring_cqe *>(completion_ring + parameters.cq_off.cqes);
+            return true;
+        }
+
+        int enter(unsigned submit, unsigned wait)
+        {
+            int result;
+            do
+                result = static_cast<int>(::syscall(__NR_io_uring_enter, descriptor, submit, wait,
+                                                    (wait > 0) ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+            while((result < 0) && (errno == EINTR));
+            return result;
+        }
+
+        bool read(int file, char *block, std::size_t length, std::size_t offset, void *user)
+        {
+            const unsigned tail = *submission_tail;
+            const unsigned index = tail & *submission_mask;
+            io_uring_sqe &entry = static_cast<io_uring_sqe *>(entries)[index];
+            std::memset(&entry, 0, sizeof(entry));
+            entry.opcode = IORING_OP_READ;
+            entry.fd = file;
+            entry.addr = reinterpret_cast<std::uint64_t>(block);
+            entry.len = static_cast<std::uint32_t>(length);
+            entry.off = offset;
+            entry.user_data = reinterpret_cast<std::uint64_t>(user);
+            submission_array[index] = index;
+            __atomic_store_n(submission_tail, tail + 1, __ATOMIC_RELEASE);
+            if(enter(1, 0) == 1)
+                return true;
+
+            // The entry was not consumed, it is taken back before the kernel sees it again
+            __atomic_store_n(submission_tail, tail, __ATOMIC_RELEASE);
+            return false;
+        }
+    };
+#else
+    struct ReadAhead::Ring
+    {
+    };
+#endif
+
+    ReadAhead::ReadAhead(std::size_t depth) : _depth{std::max<std::size_t>(depth, 1)}
+    {
+#if defined(EJSON_HAS_IO_URING)
+        std::unique_ptr<Ring> ring {new Ring{}};
+        if(ring->setup(static_cast<unsigned>(std::min(_depth, MAX_RING_DEPTH))))
+        {
+            _depth = std::min<std::size_t>(_depth, ring->capacity);
+            _ring = std::move(ring);
+        }
+#endif
+    }
+
+    ReadAhead::~ReadAhead()
+    {
+        clear();
+    }
+
+    void ReadAhead::request(const FileProvider &provider, const ArenaString &path, MemoryResource *resource)
+    {
+        const ArenaString canonical = canonicalPath(path);
+        std::string key {canonical.data(), canonical.size()};
+        if(_index.count(key) > 0)
+            return;
+        const bool kernel = _ring && (&provider == fileSystemProvider());
+        _requests.push_back(Request{std::string{path.data(), path.size()}, FileBuffer{}, RequestState::REQUEST_QUEUED,
+                                    kernel, resource, -1, nullptr, 0, 0});
+        Request &request = _requests.back();
+        _index.emplace(std::move(key), &request);
+        if(kernel)
+        {
+            _queued.push_back(&request);
+            submitQueued();
+        }
+        else
+            loadOnThread(request, provider);
+    }
+
+    void ReadAhead::loadOnThread(Request &request, const FileProvider &provider)
+    {
+        // Threads load through the provider, which must be thread-safe as for workers
+        if(!_threads)
+            _threads.reset(new ThreadPool{_depth});
+        const FileProvider *source = &provider;
+        _threads->submit([this, &request, source] (std::size_t)
+        {
+            {
+                std::lock_guard<std::mutex> lock{_mutex};
+                if(request.state != RequestState::REQUEST_QUEUED)
+                    return;
+                request.state = RequestState::REQUEST_READING;
+            }
+            FileBuffer buffer {};
+            const bool loaded = source->load(request.path.c_str(), buffer, newDeleteResource());
+            {
+                std::lock_guard<std::mutex> lock{_mutex};
+                request.buffer = std::move(buffer);
+                request.state = loaded ? RequestState::REQUEST_DONE : RequestState::REQUEST_FAILED;
+            }
+            _loaded.notify_all();
+        });
+    }
+
+    void ReadAhead::submitQueued()
+    {
+#if defined(EJSON_HAS_IO_URING)
+        // Files are opened and sized here, only their contents are read in the background
+        while(!_queued.empty() && (_in_flight < _depth))
+        {
+            Request &request = *_queued.front();
+            _queued.pop_front();
+            if(request.state != RequestState::REQUEST_QUEUED)
+                continue;
+            FileStamp stamp {};
+            request.descriptor = ::open(request.path.c_str(), O_RDONLY | O_CLOEXEC);
+            if((request.descriptor < 0) || !stamp.read(request.descriptor))
+            {
+                finishRead(request, RequestState::REQUEST_FAILED);
+                continue;
+            }
+            request.size = static_cast<std::size_t>(stamp.size);
+            request.block = request.buffer.allocate(request.size, request.resource, stamp);
+            request.state = RequestState::REQUEST_READING;
+            if(request.size == 0)
+                finishRead(request, RequestState::REQUEST_DONE);
+            else if(submitRead(request))
+                ++_in_flight;
+            else
+                readOnThread(request);
+        }
+#endif
+    }
+
+    void ReadAhead::readOnThread(Request &request)
+    {
+        // Reads refused by the kernel are started over by a thread, from the file on disk
+        finishRead(request, RequestState::REQUEST_QUEUED);
+        request.kernel = false;
+        request.block = nullptr;
+        request.total = 0;
+        loadOnThread(request, *fileSystemProvider());
+    }
+
+    bool ReadAhead::submitRead(Request &request)
+    {
+#if defined(EJSON_HAS_IO_URING)
+        const std::size_t length = std::min(request.size - request.total, MAX_READ);
+        return _ring->read(request.descriptor, request.block + request.total, length, request.total, &request);
+#else
+        (void) request;
+        return false;
+#endif
+    }
+
+    void ReadAhead::finishRead(Request &request, RequestState state)
+    {
+#if defined(EJSON_HAS_IO_URING)
+        if(request.descriptor >= 0)
+            ::close(request.descriptor);
+        request.descriptor = -1;
+#endif
+        if(state == RequestState::REQUEST_DONE)
+            request.buffer.fill(request.total);
+        else
+            request.buffer = FileBuffer{};
+        request.state = state;
+    }
+
+    void ReadAhead::completeReads()
+    {
+#if defined(EJSON_HAS_IO_URING)
+        // Wait for one read at least, then take every completion there is
+        _ring->enter(0, 1);
+        unsigned head = *_ring->completion_head;
+        const unsigned tail = __atomic_load_n(_ring->completion_tail, __ATOMIC_ACQUIRE);
+        for(; head != tail; ++head)
+        {
+            const io_uring_cqe &completion = _ring->completions[head & *_ring->completion_mask];
+            Request &request = *reinterpret_cast<Request *>(completion.user_data);
+            const int result = completion.res;
+            __atomic_store_n(_ring->completion_head, head + 1, __ATOMIC_RELEASE);
+
+            // A file ending before its size was read is taken as it is, as by a load
+            if(result > 0)
+                request.total += static_cast<std::size_t>(result);
+            const bool again = (result == -EINTR) || (result == -EAGAIN) || ((result > 0) && (request.total < request.size));
+            if(again && submitRead(request))
+                continue;
+            if((result >= 0) && !again)
+                finishRead(request, RequestState::REQUEST_DONE);
+            else
+                readOnThread(request);
+            --_in_flight;
+        }
+        submitQueued();
+#endif
+    }
+
+    bool ReadAhead::take(const ArenaString &path, FileBuffer &buffer)
+    {
+        const ArenaString canonical = canonicalPath(path);
+        auto search_result = _index.find(std::string{canonical.data(), canonical.size()});
+        if(search_result == std::end(_index))
+            return false;
+
+        // Files not being read yet are left to the caller, who needs them now
+        Request &request = *search_result->second;
+        std::unique_lock<std::mutex> lock{_mutex};
+        if(request.state == RequestState::REQUEST_QUEUED)
+        {
+            request.state = RequestState::REQUEST_TAKEN;
+            return false;
+        }
+        // A kernel read refused meanwhile is queued for a thread, the caller loads the file instead
+        if(request.kernel)
+        {
+            while(request.kernel && (request.state == RequestState::REQUEST_READING))
+                completeReads();
+        }
+        else
+            _loaded.wait(lock, [&request] { return request.state != RequestState::REQUEST_READING; });
+        const bool loaded = (request.state == RequestState::REQUEST_DONE);
+        if(loaded)
+            buffer = std::move(request.buffer);
+        request.state = RequestState::REQUEST_TAKEN;
+        return loaded;
+    }
+
+    void ReadAhead::clear()
+    {
+        // Reads in flight are waited for before their blocks are released, queued files are dropped,
+        // also those queued for threads by refused kernel reads
+        _queued.clear();
+        while(_in_flight > 0)
+            completeReads();
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            for(Request &request : _requests)
+            {
+                if(request.state == RequestState::REQUEST_QUEUED)
+                    request.state = RequestState::REQUEST_TAKEN;
+            }
+        }
+        if(_threads)
+            _threads->wait();
+        _requests.clear();
+        _index.clear();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#ifndef EJSON_READAHEAD_H
+#define EJSON_READAHEAD_H
+
+#include <string>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include "tokenizer.h"
+#include "buffer.h"
+
+/* ejson library namespace */
+namespace ejson
+{
+
+    /* Files read ahead of import resolution, see TokenizerOptions::read_ahead.
+       Requested files are read in the background, at most depth files at a time, and taken
+       by the loads that reach them later. Files on disk are read through io_uring on Linux
+       where the kernel allows it, into blocks of the given memory resource. Files of other
+       providers, files on disk without io_uring and those the kernel refuses to read are
+       loaded by threads of their own into blocks of the heap. Requests and loads come from
+       one thread at a time. */
+    class ReadAhead
+    {
+    private:
+        enum RequestState
+        {
+            REQUEST_QUEUED,
+            REQUEST_READING,
+            REQUEST_DONE,
+            REQUEST_FAILED,
+            REQUEST_TAKEN
+        };
+        struct Request
+        {
+            std::string path;
+            FileBuffer buffer;
+            RequestState state;
+            // Reads through io_uring into a block of the resource, until the size of the file
+            // is read or the file ends earlier
+            bool kernel;
+            MemoryResource *resource;
+            int descriptor;
+            char *block;
+            std::size_t size;
+            std::size_t total;
+        };
+        struct Ring;
+        std::size_t _depth;
+        std::unique_ptr<Ring> _ring;
+        std::unique_ptr<ThreadPool> _threads;
+        // References to requests stay valid while requests are added
+        std::deque<Request> _requests {};
+        std::unordered_map<std::string, Request *> _index {};
+        std::deque<Request *> _queued {};
+        std::size_t _in_flight {0};
+        std::mutex _mutex {};
+        std::condition_variable _loaded {};
+        void loadOnThread(Request &, const FileProvider &);
+        void submitQueued();
+        bool submitRead(Request &);
+        void readOnThread(Request &);
+        void finishRead(Request &, RequestState);
+        void completeReads();
+
+    public:
+        explicit ReadAhead(std::size_t depth);
+        ReadAhead(const ReadAhead &) = delete;
+        ReadAhead &operator=(const ReadAhead &) = delete;
+        ~ReadAhead();
+
+        // Read the file in the background, unless it was requested before
+        void request(const FileProvider &, const ArenaString &, MemoryResource *);
+
+        // Contents of a requested file, waiting for a read in flight. False if the file was not
+        // requested, is still queued or failed to read; the caller then loads it itself.
+        bool take(const ArenaString &, FileBuffer &);
+
+        // Drop the files not taken, once the reads in flight are done
+        void clear();
+
+        // Whether files on disk are read through io_uring
+        bool kernelReads() const { return _ring != nullptr; }
+    };
+}
+
+#endif
\ No newline at end of file
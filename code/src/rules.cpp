@@ -1,165 +1,130 @@
 #include "tokenizer.h"
-#include <iostream>
-#include <algorithm>
-#include <limits>
-#include <cctype>
 
 namespace ejson
 {
-    bool Tokenizer::transitionRulesApplied (Scope &scope, const Token &token)
+    /* Transition rules as tables built at compile time: the token is mapped to its class,
+       and the current scope and the token class select the next scope and the stack action */
+    enum TokenClass : unsigned char
+    {
+        TOKEN_CLASS_OTHER,
+        TOKEN_CLASS_OBJECT_BEGIN,
+        TOKEN_CLASS_OBJECT_END,
+        TOKEN_CLASS_ARRAY_BEGIN,
+        TOKEN_CLASS_ARRAY_END,
+        TOKEN_CLASS_STRING_DELIMITER,
+        TOKEN_CLASS_VALUE_END,
+        TOKEN_CLASS_NUMBER,
+        TOKEN_CLASS_LITERAL,
+        TOKEN_CLASSES
+    };
+    enum StackAction : unsigned char
+    {
+        ACTION_REJECT,
+        // Enter the target scope without a stack entry, e.g. the key of an object
+        ACTION_ENTER,
+        ACTION_PUSH,
+        // Return to the scope on top of the stack after popping
+        ACTION_POP,
+        // Return from a value to the array or object holding it
+        ACTION_POP_TO_CONTAINER
+    };
+    struct Transition
+    {
+        StackAction action;
+        ScopeType target;
+    };
+
+    static const std::size_t SCOPE_TYPES = ScopeType::SCOPE_LITERAL + 1;
+
+    struct TokenClassTable
     {
-        bool transition_allowed{true};
-        ScopeType last_scope = scope.previous;
-        switch (scope.current)
+        TokenClass classes[256];
+    };
+    struct TransitionTable
+    {
+        Transition transitions[SCOPE_TYPES][TOKEN_CLASSES];
+    };
+
+    static constexpr TokenClassTable makeTokenClassTable()
+    {
+        TokenClassTable table{};
+        for(std::size_t c = 0; c < 256; ++c)
+            table.classes[c] = TOKEN_CLASS_OTHER;
+        table.classes[(unsigned char) Token::OBJECT_BEGIN] = TOKEN_CLASS_OBJECT_BEGIN;
+        table.classes[(unsigned char) Token::OBJECT_END] = TOKEN_CLASS_OBJECT_END;
+        table.classes[(unsigned char) Token::ARRAY_BEGIN] = TOKEN_CLASS_ARRAY_BEGIN;
+        table.classes[(unsigned char) Token::ARRAY_END] = TOKEN_CLASS_ARRAY_END;
+        table.classes[(unsigned char) Token::STRING_DELIMITER] = TOKEN_CLASS_STRING_DELIMITER;
+        table.classes[(unsigned char) Token::VALUE_END] = TOKEN_CLASS_VALUE_END;
+        table.classes[(unsigned char) Token::NUMBER] = TOKEN_CLASS_NUMBER;
+        table.classes[(unsigned char) Token::LITERAL] = TOKEN_CLASS_LITERAL;
+        return table;
+    }
+
+    static constexpr TransitionTable makeTransitionTable()
+    {
+        TransitionTable table{};
+        for(std::size_t scope = 0; scope < SCOPE_TYPES; ++scope)
+            for(std::size_t token_class = 0; token_class < TOKEN_CLASSES; ++token_class)
+                table.transitions[scope][token_class] = Transition{ACTION_REJECT, ScopeType::SCOPE_EMPTY};
+
+        // Containers begin the file, and any value in arrays and after keys
+        const ScopeType value_holders[] = {ScopeType::SCOPE_EMPTY, ScopeType::SCOPE_ARRAY, ScopeType::SCOPE_KEY};
+        for(ScopeType scope : value_holders)
         {
+            table.transitions[scope][TOKEN_CLASS_ARRAY_BEGIN] = Transition{ACTION_PUSH, ScopeType::SCOPE_ARRAY};
+            table.transitions[scope][TOKEN_CLASS_OBJECT_BEGIN] = Transition{ACTION_PUSH, ScopeType::SCOPE_OBJECT};
+            if(scope == ScopeType::SCOPE_EMPTY)
+                continue;
+            table.transitions[scope][TOKEN_CLASS_STRING_DELIMITER] = Transition{ACTION_PUSH, ScopeType::SCOPE_STRING};
+            table.transitions[scope][TOKEN_CLASS_NUMBER] = Transition{ACTION_PUSH, ScopeType::SCOPE_NUMBER};
+            table.transitions[scope][TOKEN_CLASS_LITERAL] = Transition{ACTION_PUSH, ScopeType::SCOPE_LITERAL};
+        }
 
-        case ScopeType::SCOPE_EMPTY:
-            switch (token)
-            {
-            case Token::ARRAY_BEGIN:
-                scope.previous = scope.current;
-                scope.current = ScopeType::SCOPE_ARRAY;
-                pushStack(ScopeType::SCOPE_ARRAY);
-                break;
-            case Token::OBJECT_BEGIN:
-                scope.previous = scope.current;
-                scope.current = ScopeType::SCOPE_OBJECT;
-                pushStack(ScopeType::SCOPE_OBJECT);
-                break;
-            default:
-                transition_allowed = false;
-                break;
-            }
-            break;
+        table.transitions[ScopeType::SCOPE_ARRAY][TOKEN_CLASS_ARRAY_END] = Transition{ACTION_POP, ScopeType::SCOPE_EMPTY};
+        table.transitions[ScopeType::SCOPE_OBJECT][TOKEN_CLASS_STRING_DELIMITER] = Transition{ACTION_ENTER, ScopeType::SCOPE_KEY};
+        table.transitions[ScopeType::SCOPE_OBJECT][TOKEN_CLASS_OBJECT_END] = Transition{ACTION_POP, ScopeType::SCOPE_EMPTY};
 
-        case ScopeType::SCOPE_ARRAY:
-            switch (token)
-            {
-            case Token::ARRAY_BEGIN:
-                scope.previous = scope.current;
-                scope.current = ScopeType::SCOPE_ARRAY;
-                pushStack(ScopeType::SCOPE_ARRAY);
-                break;
-            case Token::OBJECT_BEGIN:
-                scope.previous = scope.current;
-                scope.current = ScopeType::SCOPE_OBJECT;
-                pushStack(ScopeType::SCOPE_OBJECT);
-                break;
-            case Token::STRING_DELIMITER:
-                scope.previous = scope.current;
-                scope.current = ScopeType::SCOPE_STRING;
-                pushStack(ScopeType::SCOPE_STRING);
-                break;
-            case Token::NUMBER:
-                scope.previous = scope.current;
-                scope.current = ScopeType::SCOPE_NUMBER;
-                pushStack(ScopeType::SCOPE_NUMBER);
-                break;
-            case Token::LITERAL:
-                scope.previous = scope.current;
-                scope.current = ScopeType::SCOPE_LITERAL;
-                pushStack(ScopeType::SCOPE_LITERAL);
-                break;
-            case Token::ARRAY_END:
-                scope.previous = scope.current;
-                popStack();
-                scope.current = stackTop();
-                break;
-            default:
-                transition_allowed = false;
-                break;
-            }
-            break;
+        // Values end with a separator, or with the end of the array holding them
+        const ScopeType values[] = {ScopeType::SCOPE_STRING, ScopeType::SCOPE_NUMBER, ScopeType::SCOPE_LITERAL};
+        for(ScopeType scope : values)
+        {
+            table.transitions[scope][TOKEN_CLASS_VALUE_END] = Transition{ACTION_POP_TO_CONTAINER, ScopeType::SCOPE_EMPTY};
+            table.transitions[scope][TOKEN_CLASS_ARRAY_END] = Transition{ACTION_POP_TO_CONTAINER, ScopeType::SCOPE_EMPTY};
+        }
+        return table;
+    }
 
-        case ScopeType::SCOPE_OBJECT:
-            switch (token)
-            {
-            case Token::STRING_DELIMITER:
-                scope.previous = scope.current;
-                scope.current = ScopeType::SCOPE_KEY;
-                break;
-            case Token::OBJECT_END:
-                scope.previous = scope.current;
-                popStack();
-                scope.current = stackTop();
-                break;
-            default:
-                transition_allowed = false;
-                break;
-            }
-            break;
+    static constexpr TokenClassTable TOKEN_CLASS_TABLE = makeTokenClassTable();
+    static constexpr TransitionTable TRANSITION_TABLE = makeTransitionTable();
 
-        case ScopeType::SCOPE_KEY:
-            switch (token)
-            {
-            case Token::ARRAY_BEGIN:
-                scope.previous = scope.current;
-                scope.current = ScopeType::SCOPE_ARRAY;
-                pushStack(ScopeType::SCOPE_ARRAY);
-                break;
-            case Token::OBJECT_BEGIN:
-                scope.previous = scope.current;
-                scope.current = ScopeType::SCOPE_OBJECT;
-                pushStack(ScopeType::SCOPE_OBJECT);
-                break;
-            case Token::STRING_DELIMITER:
-                scope.previous = scope.current;
-                scope.current = ScopeType::SCOPE_STRING;
-                pushStack(ScopeType::SCOPE_STRING);
-                break;
-            case Token::NUMBER:
-                scope.previous = scope.current;
-                scope.current = ScopeType::SCOPE_NUMBER;
-                pushStack(ScopeType::SCOPE_NUMBER);
-                break;
-            case Token::LITERAL:
-                scope.previous = scope.current;
-                scope.current = ScopeType::SCOPE_LITERAL;
-                pushStack(ScopeType::SCOPE_LITERAL);
-                break;
-            default:
-                transition_allowed = false;
-                break;
-            }
-            break;
-        
-        case ScopeType::SCOPE_STRING:
-        case ScopeType::SCOPE_NUMBER:
-        case ScopeType::SCOPE_LITERAL:
-            switch (token)
-            {
-            case Token::VALUE_END:
-                if(scope.previous == ScopeType::SCOPE_ARRAY)
-                {
-                    scope.previous = scope.current;
-                    scope.current = ScopeType::SCOPE_ARRAY;
-                }
-                else
-                {
-                    scope.previous = scope.current;
-                    scope.current = ScopeType::SCOPE_OBJECT;
-                }
-                popStack();
-                break;
-            case Token::ARRAY_END:
-                scope.previous = scope.current;
-                if (last_scope == ScopeType::SCOPE_ARRAY)
-                    scope.current = last_scope;
-                else
-                    scope.current = ScopeType::SCOPE_OBJECT;
-                popStack();
-                break;
-            default:
-                transition_allowed = false;
-                break;
-            }
-            break;
-        
+    bool Tokenizer::transitionRulesApplied (Scope &scope, const Token &token)
+    {
+        const Transition &transition =
+            TRANSITION_TABLE.transitions[scope.current][TOKEN_CLASS_TABLE.classes[(unsigned char) token]];
+        const ScopeType last_scope = scope.previous;
+        switch (transition.action)
+        {
+        case StackAction::ACTION_ENTER:
+            scope.previous = scope.current;
+            scope.current = transition.target;
+            return true;
+        case StackAction::ACTION_PUSH:
+            scope.previous = scope.current;
+            scope.current = transition.target;
+            return pushStack(transition.target);
+        case StackAction::ACTION_POP:
+            scope.previous = scope.current;
+            popStack();
+            scope.current = stackTop();
+            return true;
+        case StackAction::ACTION_POP_TO_CONTAINER:
+            scope.previous = scope.current;
+            scope.current = (last_scope == ScopeType::SCOPE_ARRAY) ? ScopeType::SCOPE_ARRAY : ScopeType::SCOPE_OBJECT;
+            popStack();
+            return true;
         default:
-            transition_allowed = false;
-            break;
+            return false;
         }
-
-        return transition_allowed;
     }
 }
\ No newline at end of file
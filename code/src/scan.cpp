@@ -0,0 +1,395 @@
+#include "scan.h"
+
+#if !defined(EJSON_SCAN_SCALAR) && (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define EJSON_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace ejson
+{
+    /* Scalar kernels, also used for the tail of every vectorized scan */
+
+    static const char *findQuoteScalar(const char *p, const char *end)
+    {
+        while((p < end) && (*p != '"'))
+            ++p;
+        return p;
+    }
+
+    static const char *skipWhitespaceScalar(const char *p, const char *end)
+    {
+        while((p < end) && isWhitespace(*p))
+            ++p;
+        return p;
+    }
+
+    static const char *skipWordScalar(const char *p, const char *end)
+    {
+        while((p < end) && ((charClass(*p) & ~CharClass::CHAR_CLASS_DIGIT) == 0))
+            ++p;
+        return p;
+    }
+
+    static const char *findStructureScalar(const char *p, const char *end)
+    {
+        while((p < end) && (((charClass(*p) & (CharClass::CHAR_CLASS_STRUCTURAL | CharClass::CHAR_CLASS_QUOTE |
+                                               CharClass::CHAR_CLASS_COMMENT)) == 0) || (*p == ',')))
+            ++p;
+        return p;
+    }
+
+    // Colons and commas terminate keys and values, brackets are tokens of their own
+    static inline bool isTokenBound(char c)
+    {
+        return (c == '{') || (c == '}') || (c == '[') || (c == ']') || (c == ',') || (c == ':');
+    }
+
+    static std::size_t boundTokensScalar(const char *p, const char *end)
+    {
+        std::size_t count {0};
+        bool in_string {false};
+        for(; p < end; ++p)
+        {
+            if(*p == '"')
+                in_string = !in_string;
+            else if(!in_string && isTokenBound(*p))
+                ++count;
+        }
+        return count;
+    }
+
+#if defined(EJSON_SCAN_X86)
+
+    /* SSE2 kernels, 32 bytes per iteration as two 16-byte lanes */
+
+    // Bytes equal to c
+    static inline __m128i equalSse2(__m128i block, char c)
+    {
+        return _mm_cmpeq_epi8(block, _mm_set1_epi8(c));
+    }
+
+    // Bytes within [low, low + span] compared as unsigned
+    static inline __m128i rangeSse2(__m128i block, char low, char span)
+    {
+        __m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8(low));
+        return _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(span)), shifted);
+    }
+
+    static inline __m128i whitespaceSse2(__m128i block)
+    {
+        return _mm_or_si128(equalSse2(block, ' '), rangeSse2(block, '\t', '\r' - '\t'));
+    }
+
+    static inline __m128i delimiterSse2(__m128i block)
+    {
+        __m128i brackets = _mm_or_si128(_mm_or_si128(equalSse2(block, '{'), equalSse2(block, '}')),
+                                        _mm_or_si128(equalSse2(block, '['), equalSse2(block, ']')));
+        __m128i separators = _mm_or_si128(_mm_or_si128(equalSse2(block, ':'), equalSse2(block, ',')),
+                                          _mm_or_si128(equalSse2(block, '"'), equalSse2(block, '#')));
+        return _mm_or_si128(_mm_or_si128(brackets, separators), whitespaceSse2(block));
+    }
+
+    static inline __m128i structureSse2(__m128i block)
+    {
+        __m128i brackets = _mm_or_si128(_mm_or_si128(equalSse2(block, '{'), equalSse2(block, '}')),
+                                        _mm_or_si128(equalSse2(block, '['), equalSse2(block, ']')));
+        __m128i others = _mm_or_si128(equalSse2(block, ':'), _mm_or_si128(equalSse2(block, '"'), equalSse2(block, '#')));
+        return _mm_or_si128(brackets, others);
+    }
+
+    // Mask of the bytes that stop a scan, one bit per byte of the 32-byte block
+    enum StopCondition
+    {
+        STOP_AT_QUOTE,
+        STOP_AFTER_WHITESPACE,
+        STOP_AT_DELIMITER,
+        STOP_AT_STRUCTURE
+    };
+
+    template <StopCondition condition>
+    static inline std::uint32_t stopMaskSse2(const char *p)
+    {
+        std::uint32_t mask{0};
+        for(int lane = 0; lane < 2; ++lane)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * lane));
+            __m128i hits;
+            switch (condition)
+            {
+            case StopCondition::STOP_AT_QUOTE:
+                hits = equalSse2(block, '"');
+                break;
+            case StopCondition::STOP_AFTER_WHITESPACE:
+                hits = whitespaceSse2(block);
+                break;
+            case StopCondition::STOP_AT_STRUCTURE:
+                hits = structureSse2(block);
+                break;
+            default:
+                hits = delimiterSse2(block);
+                break;
+            }
+            std::uint32_t bits = static_cast<std::uint32_t>(_mm_movemask_epi8(hits)) & 0xFFFFu;
+            if(condition == StopCondition::STOP_AFTER_WHITESPACE)
+                bits ^= 0xFFFFu;
+            mask |= bits << (16 * lane);
+        }
+        return mask;
+    }
+
+    template <StopCondition condition>
+    static const char *scanSse2(const char *p, const char *end)
+    {
+        while((end - p) >= 32)
+        {
+            std::uint32_t mask = stopMaskSse2<condition>(p);
+            if(mask != 0)
+                return p + __builtin_ctz(mask);
+            p += 32;
+        }
+        return p;
+    }
+
+    // Most runs between tokens are a few bytes long: these are scanned one byte at a time
+    // before a vectorized scan is set up for the remainder
+    static const std::ptrdiff_t SHORT_RUN = 16;
+
+    template <const char *(*scalar)(const char *, const char *),
+              const char *(*vectorized)(const char *, const char *)>
+    static inline const char *scanShortFirst(const char *p, const char *end)
+    {
+        const char *short_end = ((end - p) > SHORT_RUN) ? (p + SHORT_RUN) : end;
+        p = scalar(p, short_end);
+        if((p < short_end) || (p == end))
+            return p;
+        return scalar(vectorized(p, end), end);
+    }
+
+    static const char *findQuoteSse2(const char *p, const char *end)
+    {
+        return scanShortFirst<findQuoteScalar, scanSse2<StopCondition::STOP_AT_QUOTE>>(p, end);
+    }
+
+    static const char *skipWhitespaceSse2(const char *p, const char *end)
+    {
+        return scanShortFirst<skipWhitespaceScalar, scanSse2<StopCondition::STOP_AFTER_WHITESPACE>>(p, end);
+    }
+
+    static const char *skipWordSse2(const char *p, const char *end)
+    {
+        return scanShortFirst<skipWordScalar, scanSse2<StopCondition::STOP_AT_DELIMITER>>(p, end);
+    }
+
+    static const char *findStructureSse2(const char *p, const char *end)
+    {
+        return scanShortFirst<findStructureScalar, scanSse2<StopCondition::STOP_AT_STRUCTURE>>(p, end);
+    }
+
+    // Bits of the bytes between an opening quote and its closing quote, opening quote included,
+    // as the prefix XOR of the quote bits; inside is all ones while a string is open before the block
+    static inline std::uint64_t insideStrings(std::uint64_t quotes, std::uint64_t &inside)
+    {
+        quotes ^= quotes << 1;
+        quotes ^= quotes << 2;
+        quotes ^= quotes << 4;
+        quotes ^= quotes << 8;
+        quotes ^= quotes << 16;
+        quotes ^= quotes << 32;
+        quotes ^= inside;
+        inside = static_cast<std::uint64_t>(static_cast<std::int64_t>(quotes) >> 63);
+        return quotes;
+    }
+
+    // The remainder of a vectorized count continues the string state of its last block
+    static inline std::size_t boundTokensRemainder(const char *p, const char *end, std::uint64_t inside)
+    {
+        if(inside != 0)
+        {
+            const char *closing = findQuoteScalar(p, end);
+            p = (closing < end) ? (closing + 1) : end;
+        }
+        return boundTokensScalar(p, end);
+    }
+
+    // 64 bytes per iteration as four 16-byte lanes
+    static std::size_t boundTokensSse2(const char *p, const char *end)
+    {
+        std::size_t count {0};
+        std::uint64_t inside {0};
+        for(; (end - p) >= 64; p += 64)
+        {
+            std::uint64_t quotes {0};
+            std::uint64_t bounds {0};
+            for(int lane = 0; lane < 4; ++lane)
+            {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * lane));
+                __m128i brackets = _mm_or_si128(_mm_or_si128(equalSse2(block, '{'), equalSse2(block, '}')),
+                                                _mm_or_si128(equalSse2(block, '['), equalSse2(block, ']')));
+                __m128i separators = _mm_or_si128(equalSse2(block, ','), equalSse2(block, ':'));
+                quotes |= static_cast<std::uint64_t>(_mm_movemask_epi8(equalSse2(block, '"')) & 0xFFFF) << (16 * lane);
+                bounds |= static_cast<std::uint64_t>(_mm_movemask_epi8(_mm_or_si128(brackets, separators)) & 0xFFFF) << (16 * lane);
+            }
+            count += static_cast<std::size_t>(__builtin_popcountll(bounds & ~insideStrings(quotes, inside)));
+        }
+        return count + boundTokensRemainder(p, end, inside);
+    }
+
+#if defined(EJSON_SCAN_AVX2)
+
+    /* AVX2 kernels, 64 bytes per iteration as two 32-byte lanes.
+       Intermittent 256-bit work is slowed down on many CPUs while the vector units power up,
+       so that they only pay off where long runs are frequent; they are built on request. */
+
+#define EJSON_AVX2 __attribute__((target("avx2")))
+
+    EJSON_AVX2 static inline __m256i equalAvx2(__m256i block, char c)
+    {
+        return _mm256_cmpeq_epi8(block, _mm256_set1_epi8(c));
+    }
+
+    EJSON_AVX2 static inline __m256i rangeAvx2(__m256i block, char low, char span)
+    {
+        __m256i shifted = _mm256_sub_epi8(block, _mm256_set1_epi8(low));
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(span)), shifted);
+    }
+
+    EJSON_AVX2 static inline __m256i whitespaceAvx2(__m256i block)
+    {
+        return _mm256_or_si256(equalAvx2(block, ' '), rangeAvx2(block, '\t', '\r' - '\t'));
+    }
+
+    EJSON_AVX2 static inline __m256i delimiterAvx2(__m256i block)
+    {
+        __m256i brackets = _mm256_or_si256(_mm256_or_si256(equalAvx2(block, '{'), equalAvx2(block, '}')),
+                                           _mm256_or_si256(equalAvx2(block, '['), equalAvx2(block, ']')));
+        __m256i separators = _mm256_or_si256(_mm256_or_si256(equalAvx2(block, ':'), equalAvx2(block, ',')),
+                                             _mm256_or_si256(equalAvx2(block, '"'), equalAvx2(block, '#')));
+        return _mm256_or_si256(_mm256_or_si256(brackets, separators), whitespaceAvx2(block));
+    }
+
+    EJSON_AVX2 static inline __m256i structureAvx2(__m256i block)
+    {
+        __m256i brackets = _mm256_or_si256(_mm256_or_si256(equalAvx2(block, '{'), equalAvx2(block, '}')),
+                                           _mm256_or_si256(equalAvx2(block, '['), equalAvx2(block, ']')));
+        __m256i others = _mm256_or_si256(equalAvx2(block, ':'), _mm256_or_si256(equalAvx2(block, '"'), equalAvx2(block, '#')));
+        return _mm256_or_si256(brackets, others);
+    }
+
+    template <StopCondition condition>
+    EJSON_AVX2 static inline std::uint64_t stopMaskAvx2(const char *p)
+    {
+        std::uint64_t mask{0};
+        for(int lane = 0; lane < 2; ++lane)
+        {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 32 * lane));
+            __m256i hits;
+            switch (condition)
+            {
+            case StopCondition::STOP_AT_QUOTE:
+                hits = equalAvx2(block, '"');
+                break;
+            case StopCondition::STOP_AFTER_WHITESPACE:
+                hits = whitespaceAvx2(block);
+                break;
+            case StopCondition::STOP_AT_STRUCTURE:
+                hits = structureAvx2(block);
+                break;
+            default:
+                hits = delimiterAvx2(block);
+                break;
+            }
+            std::uint64_t bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(hits));
+            if(condition == StopCondition::STOP_AFTER_WHITESPACE)
+                bits ^= 0xFFFFFFFFu;
+            mask |= bits << (32 * lane);
+        }
+        return mask;
+    }
+
+    template <StopCondition condition>
+    EJSON_AVX2 static const char *scanAvx2(const char *p, const char *end)
+    {
+        while((end - p) >= 64)
+        {
+            std::uint64_t mask = stopMaskAvx2<condition>(p);
+            if(mask != 0)
+                return p + __builtin_ctzll(mask);
+            p += 64;
+        }
+        return p;
+    }
+
+    // The remainder of a long run, less than 64 bytes, is left to the SSE2 and scalar scans
+    template <StopCondition condition>
+    EJSON_AVX2 static const char *scanLongAvx2(const char *p, const char *end)
+    {
+        return scanSse2<condition>(scanAvx2<condition>(p, end), end);
+    }
+
+    // 64 bytes per iteration as two 32-byte lanes
+    EJSON_AVX2 static std::size_t boundTokensAvx2(const char *p, const char *end)
+    {
+        std::size_t count {0};
+        std::uint64_t inside {0};
+        for(; (end - p) >= 64; p += 64)
+        {
+            std::uint64_t quotes {0};
+            std::uint64_t bounds {0};
+            for(int lane = 0; lane < 2; ++lane)
+            {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 32 * lane));
+                __m256i brackets = _mm256_or_si256(_mm256_or_si256(equalAvx2(block, '{'), equalAvx2(block, '}')),
+                                                   _mm256_or_si256(equalAvx2(block, '['), equalAvx2(block, ']')));
+                __m256i separators = _mm256_or_si256(equalAvx2(block, ','), equalAvx2(block, ':'));
+                quotes |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(equalAvx2(block, '"')))) << (32 * lane);
+                bounds |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(brackets, separators)))) << (32 * lane);
+            }
+            count += static_cast<std::size_t>(__builtin_popcountll(bounds & ~insideStrings(quotes, inside)));
+        }
+        return count + boundTokensRemainder(p, end, inside);
+    }
+
+    static const char *findQuoteAvx2(const char *p, const char *end)
+    {
+        return scanShortFirst<findQuoteScalar, scanLongAvx2<StopCondition::STOP_AT_QUOTE>>(p, end);
+    }
+
+    static const char *skipWhitespaceAvx2(const char *p, const char *end)
+    {
+        return scanShortFirst<skipWhitespaceScalar, scanLongAvx2<StopCondition::STOP_AFTER_WHITESPACE>>(p, end);
+    }
+
+    static const char *skipWordAvx2(const char *p, const char *end)
+    {
+        return scanShortFirst<skipWordScalar, scanLongAvx2<StopCondition::STOP_AT_DELIMITER>>(p, end);
+    }
+
+    static const char *findStructureAvx2(const char *p, const char *end)
+    {
+        return scanShortFirst<findStructureScalar, scanLongAvx2<StopCondition::STOP_AT_STRUCTURE>>(p, end);
+    }
+
+#undef EJSON_AVX2
+
+#endif
+#endif
+
+    static ScanKernels selectScanKernels()
+    {
+#if defined(EJSON_SCAN_X86)
+        __builtin_cpu_init();
+#if defined(EJSON_SCAN_AVX2)
+        if(__builtin_cpu_supports("avx2"))
+            return ScanKernels{ScanLevel::SCAN_AVX2, findQuoteAvx2, skipWhitespaceAvx2, skipWordAvx2,
+                               boundTokensAvx2, findStructureAvx2};
+#endif
+        if(__builtin_cpu_supports("sse2"))
+            return ScanKernels{ScanLevel::SCAN_SSE2, findQuoteSse2, skipWhitespaceSse2, skipWordSse2,
+                               boundTokensSse2, findStructureSse2};
+#endif
+        return ScanKernels{ScanLevel::SCAN_SCALAR, findQuoteScalar, skipWhitespaceScalar, skipWordScalar,
+                           boundTokensScalar, findStructureScalar};
+    }
+
+    const ScanKernels SCAN_KERNELS = selectScanKernels();
+}
\ No newline at end of file
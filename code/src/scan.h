@@ -0,0 +1,177 @@
+#ifndef EJSON_SCAN_H
+#define EJSON_SCAN_H
+
+#include <string>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+/* ejson library namespace */
+namespace ejson
+{
+
+    /* Locale-free character classes used by the buffer scanner */
+    enum CharClass : unsigned char
+    {
+        CHAR_CLASS_OTHER             = 0x00,
+        CHAR_CLASS_WHITESPACE        = 0x01,
+        CHAR_CLASS_DIGIT             = 0x02,
+        CHAR_CLASS_STRUCTURAL        = 0x04,
+        CHAR_CLASS_QUOTE             = 0x08,
+        CHAR_CLASS_COMMENT           = 0x10
+    };
+
+    struct CharClassTable
+    {
+        unsigned char classes[256];
+
+        constexpr CharClassTable() : classes{}
+        {
+            classes[(unsigned char) ' '] = CharClass::CHAR_CLASS_WHITESPACE;
+            classes[(unsigned char) '\t'] = CharClass::CHAR_CLASS_WHITESPACE;
+            classes[(unsigned char) '\n'] = CharClass::CHAR_CLASS_WHITESPACE;
+            classes[(unsigned char) '\v'] = CharClass::CHAR_CLASS_WHITESPACE;
+            classes[(unsigned char) '\f'] = CharClass::CHAR_CLASS_WHITESPACE;
+            classes[(unsigned char) '\r'] = CharClass::CHAR_CLASS_WHITESPACE;
+            for(char c = '0'; c <= '9'; ++c)
+                classes[(unsigned char) c] = CharClass::CHAR_CLASS_DIGIT;
+            classes[(unsigned char) '{'] = CharClass::CHAR_CLASS_STRUCTURAL;
+            classes[(unsigned char) '}'] = CharClass::CHAR_CLASS_STRUCTURAL;
+            classes[(unsigned char) '['] = CharClass::CHAR_CLASS_STRUCTURAL;
+            classes[(unsigned char) ']'] = CharClass::CHAR_CLASS_STRUCTURAL;
+            classes[(unsigned char) ':'] = CharClass::CHAR_CLASS_STRUCTURAL;
+            classes[(unsigned char) ','] = CharClass::CHAR_CLASS_STRUCTURAL;
+            classes[(unsigned char) '"'] = CharClass::CHAR_CLASS_QUOTE;
+            classes[(unsigned char) '#'] = CharClass::CHAR_CLASS_COMMENT;
+        }
+    };
+    static constexpr CharClassTable CHAR_CLASSES{};
+
+    inline unsigned char charClass(char c)
+    {
+        return CHAR_CLASSES.classes[(unsigned char) c];
+    }
+
+    inline bool isWhitespace(char c)
+    {
+        return charClass(c) == CharClass::CHAR_CLASS_WHITESPACE;
+    }
+
+    inline bool isDigit(char c)
+    {
+        return charClass(c) == CharClass::CHAR_CLASS_DIGIT;
+    }
+
+    /* Vectorized scanning kernels, selected once at startup for the running CPU.
+       Every kernel returns the first position in [p, end) that stops its run. */
+    enum ScanLevel
+    {
+        SCAN_SCALAR,
+        SCAN_SSE2,
+        SCAN_AVX2
+    };
+    typedef const char *(*ScanKernel)(const char *, const char *);
+
+    // Brackets, commas and colons outside of strings in [p, end). Every value is followed by
+    // a comma or a closing bracket and every key by a colon, so that a file body holds
+    // at most this many tokens. Quotes within comments can make the count fall short.
+    typedef std::size_t (*CountKernel)(const char *, const char *);
+    struct ScanKernels
+    {
+        ScanLevel level;
+        ScanKernel findQuote;
+        ScanKernel skipWhitespace;
+        ScanKernel skipWord;
+        CountKernel boundTokens;
+        // Next bracket, colon, quote or comment, i.e. what a structural index records or skips
+        ScanKernel findStructure;
+    };
+    extern const ScanKernels SCAN_KERNELS;
+
+    /* Raw cursor over the contents of a file buffer */
+    struct Cursor
+    {
+        const char *begin {nullptr};
+        const char *position {nullptr};
+        const char *end {nullptr};
+
+        bool eof() const
+        {
+            return position >= end;
+        }
+
+        // Skip blank space, line breaks and comments up to the next significant character
+        Cursor &skipWhitespace()
+        {
+            while(position < end)
+            {
+                unsigned char type = charClass(*position);
+                if(type == CharClass::CHAR_CLASS_WHITESPACE)
+                    position = SCAN_KERNELS.skipWhitespace(position + 1, end);
+                else if(type == CharClass::CHAR_CLASS_COMMENT)
+                {
+                    const void *line_end = std::memchr(position, '\n', end - position);
+                    position = (line_end != nullptr) ? static_cast<const char *>(line_end) : end;
+                }
+                else
+                    break;
+            }
+            return *this;
+        }
+
+        bool get(char &c)
+        {
+            if(position >= end)
+                return false;
+            c = *position++;
+            return true;
+        }
+
+        bool peek(char &c) const
+        {
+            if(position >= end)
+                return false;
+            c = *position;
+            return true;
+        }
+
+        void putback()
+        {
+            if(position > begin)
+                --position;
+        }
+
+        // Find the next string delimiter, or the end of the buffer
+        const char *findQuote() const
+        {
+            return SCAN_KERNELS.findQuote(position, end);
+        }
+
+        // Extent of a bare word, e.g. a literal, up to the next delimiting character
+        const char *skipWord() const
+        {
+            return SCAN_KERNELS.skipWord(position, end);
+        }
+
+        // Line around the most recently consumed character, used for feedback snapshots
+        std::string snap() const
+        {
+            const char *p = (position > begin) ? (position - 1) : position;
+            if(p >= end)
+                p = (end > begin) ? (end - 1) : end;
+            const char *first = p;
+            while((first > begin) && (*(first - 1) != '\n'))
+                --first;
+            const char *last = p;
+            while((last < end) && (*last != '\n'))
+                ++last;
+            while((first < last) && isWhitespace(*first))
+                ++first;
+            while((last > first) && isWhitespace(*(last - 1)))
+                --last;
+            return std::string{first, last};
+        }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "tokenizer.h"
+#include "scan.h"
+#include "sink.h"
 #include <iostream>
 #include <algorithm>
 #include <limits>
@@ -6,47 +8,44 @@
 
 namespace ejson
 {
-    static const std::string LITERAL_STATEMENT_NULL = std::string{"null"};
-    static const std::string LITERAL_STATEMENT_TRUE = std::string{"true"};
-    static const std::string LITERAL_STATEMENT_FALSE = std::string{"false"};
+    static const StringView LITERAL_STATEMENT_NULL = StringView{"null", 4};
+    static const StringView LITERAL_STATEMENT_TRUE = StringView{"true", 4};
+    static const StringView LITERAL_STATEMENT_FALSE = StringView{"false", 5};
 
     void Tokenizer::scopeEmpty(Scope &scope,
-                               std::stringstream &stream,
-                               TokenizedPairs &pairs,
+                               Cursor &cursor,
+                               TokenSink &sink,
                                TokenizerFeedback &feedback)
     {
         char token{(char) Token::UNDEFINED};
-        (stream >> std::ws).get(token);
-        if(token != (char) Token::UNDEFINED)
+        if(cursor.skipWhitespace().get(token))
         {
             if(transitionRulesApplied(scope, (Token) token))
             {
-                pairs.emplace_back(TokenizedPair{.token = (Token)token,
-                                                 .value = std::string{token}});
+                sink.emit((Token) token, cursor.position - 1, 1);
             }
             else
             {
                 feedback.type = FeedbackType::NOK_PARSER_ERROR;
-                feedback.snap = stream.str();
+                feedback.snap = cursor.snap();
             }
         }
     }
 
     void Tokenizer::scopeArray(Scope &scope,
-                               std::stringstream &stream,
-                               TokenizedPairs &pairs,
+                               Cursor &cursor,
+                               TokenSink &sink,
                                TokenizerFeedback &feedback)
     {
         char token{(char) Token::UNDEFINED};
-        (stream >> std::ws).get(token);
-        if(token != (char) Token::UNDEFINED)
+        if(cursor.skipWhitespace().get(token))
         {
             bool success{true};
             // Check for NUMBER and LITERAL tokens
-            if(std::isdigit(token) != 0)
+            if(isDigit(token) || (token == (char) Token::MINUS_SIGN))
             {
-                // Write token back into stream since it is part of value
-                stream.putback(token);
+                // Write token back since it is part of value
+                cursor.putback();
                 token = (char) Token::NUMBER;
             }
             else
@@ -57,134 +56,107 @@ namespace ejson
                     case (char) Token::LITERAL_NULL:
                     case (char) Token::LITERAL_TRUE:
                     case (char) Token::LITERAL_FALSE:
-                        stream.putback(token);
+                        cursor.putback();
                         token = (char)Token::LITERAL;
                         break;
                     case (char) Token::ARRAY_END:
-                        pairs.emplace_back(TokenizedPair{.token = (Token) token,
-                                                         .value = std::string{token}});
+                        sink.emit((Token) token, cursor.position - 1, 1);
                         // Remove value separator at the end of array
-                        (stream >> std::ws).get(separator);
-                        if (separator != (char)Token::VALUE_END)
+                        if (!cursor.skipWhitespace().get(separator) || (separator != (char)Token::VALUE_END))
                             success = false;
                         break;
                     default:
                         break;
                 }
             }
-            if(!transitionRulesApplied(scope, (Token) token) || !success)
+            if(success && transitionRulesApplied(scope, (Token) token))
+            {
+                switch (token)
+                {
+                case (char)Token::OBJECT_BEGIN:
+                case (char)Token::ARRAY_BEGIN:
+                    sink.emit((Token) token, cursor.position - 1, 1);
+                    break;
+                default:
+                    break;
+                }
+            }
+            else
             {
                 feedback.type = FeedbackType::NOK_PARSER_ERROR;
-                feedback.snap = stream.str();
+                feedback.snap = cursor.snap();
             }
         }
     }
 
     void Tokenizer::scopeNumber(Scope &scope,
-                               std::stringstream &stream,
-                               TokenizedPairs &pairs,
+                               Cursor &cursor,
+                               TokenSink &sink,
                                TokenizerFeedback &feedback)
     {
-        std::string digits {""};
+        // Numbers run up to the next delimiter and are decoded right away
+        const char *number_end = cursor.skipWord();
+        const StringView text {cursor.position, static_cast<std::size_t>(number_end - cursor.position)};
+        cursor.position = number_end;
+
         char token{(char) Token::UNDEFINED};
-        bool stop{false}, success{true};
-        while(!stop && !stream.eof())
+        bool success{false};
+        Number number{};
+        if(decodeNumber(text, number) && cursor.skipWhitespace().get(token))
         {
-            (stream >> std::ws).get(token);
-            if(token != (char) Token::UNDEFINED)
-            {
-                if(std::isdigit(token) != 0)
-                    digits.push_back(token);
-                else
-                    stop = true;
-            }
-        }
-        if(!stream.eof())
-        {
-            pairs.emplace_back(TokenizedPair{.token = Token::NUMBER,
-                                             .value = digits});
+            sink.emitNumber(text.data(), text.size(), number);
             if(token == Token::ARRAY_END)
-                stream.putback(token);
+                cursor.putback();
             success = transitionRulesApplied(scope, (Token) token);
         }
-        if(stream.eof() || !success) 
+        if(!success) 
         {
             feedback.type = FeedbackType::NOK_PARSER_ERROR;
-            feedback.snap = stream.str();
+            feedback.snap = cursor.snap();
         }
     }
 
     void Tokenizer::scopeString(Scope &scope,
-                               std::stringstream &stream,
-                               TokenizedPairs &pairs,
+                               Cursor &cursor,
+                               TokenSink &sink,
                                TokenizerFeedback &feedback)
     {
-        std::string value {""};
-        bool success{true};
-        std::getline(stream, value, (char) Token::STRING_DELIMITER);
-        if(!stream.eof())
+        bool success{false};
+        const char *delimiter = cursor.findQuote();
+        if(delimiter < cursor.end)
         {
+            const StringView value {cursor.position, static_cast<std::size_t>(delimiter - cursor.position)};
+            cursor.position = delimiter + 1;
+
             char token{(char) Token::UNDEFINED};
-            (stream >> std::ws).get(token);
-            if(token != (char) Token::UNDEFINED)
+            if(cursor.skipWhitespace().get(token))
             {
-                pairs.emplace_back(TokenizedPair{.token = Token::STRING,
-                                                 .value = value});
+                sink.emit(Token::STRING, value.data(), value.size());
                 
                 if(token == Token::ARRAY_END)
-                    stream.putback(token);
+                    cursor.putback();
                 success = transitionRulesApplied(scope, (Token) token);
             }
         }
-        if(stream.eof() || !success) 
+        if(!success) 
         {
             feedback.type = FeedbackType::NOK_PARSER_ERROR;
-            feedback.snap = stream.str();
+            feedback.snap = cursor.snap();
         }
     }
 
     void Tokenizer::scopeLiteral(Scope &scope,
-                               std::stringstream &stream,
-                               TokenizedPairs &pairs,
+                               Cursor &cursor,
+                               TokenSink &sink,
                                TokenizerFeedback &feedback)
     {
-        std::string literal {""};
+        const char *literal_end = cursor.skipWord();
+        const StringView literal {cursor.position, static_cast<std::size_t>(literal_end - cursor.position)};
+        cursor.position = literal_end;
+
         char token{(char) Token::UNDEFINED};
-        bool stop{false}, success{true};
-        while(!stop && !stream.eof())
-        {
-            stream.get(token);
-            if(token != (char) Token::UNDEFINED)
-            {
-                if(token == Token::VALUE_END || token == Token::ARRAY_END)
-                {
-                    stop = true;
-                    if(token == Token::ARRAY_END)
-                        stream.putback(token);
-                }
-                else if(token == Token::BLANK_SPACE)
-                {
-                    while (!stop && !stream.eof())
-                    {
-                        (stream >> std::ws).get(token);
-                        if (token != (char)Token::UNDEFINED)
-                        {
-                            if (token == Token::VALUE_END || token == Token::ARRAY_END)
-                            {
-                                stop = true;
-                                if (token == Token::ARRAY_END)
-                                    stream.putback(token);
-                            }
-                            else
-                                success = false;
-                        }
-                    }
-                }
-                else
-                    literal.push_back(token);
-            }
-        }
-        if(!stream.eof())
+        bool success{false};
+        if(cursor.skipWhitespace().get(token))
         {
             Token result{Token::UNDEFINED};
             if (literal == LITERAL_STATEMENT_NULL)
@@ -193,118 +165,108 @@ namespace ejson
                 result = Token::LITERAL_TRUE;
             else if (literal == LITERAL_STATEMENT_FALSE)
                 result = Token::LITERAL_FALSE;
-            else
-                success = false;
-            if(success)
+
+            // Literals are only terminated by value separators or the end of an array
+            if((result != Token::UNDEFINED) &&
+               ((token == Token::VALUE_END) || (token == Token::ARRAY_END)))
             {
-                pairs.emplace_back(TokenizedPair{.token = result,
-                                                 .value = literal});
+                sink.emit(result, literal.data(), literal.size());
+                if(token == Token::ARRAY_END)
+                    cursor.putback();
                 success = transitionRulesApplied(scope, (Token)token);
             }
         }
-        if(stream.eof() || !success) 
+        if(!success) 
         {
             feedback.type = FeedbackType::NOK_PARSER_ERROR;
-            feedback.snap = stream.str();
+            feedback.snap = cursor.snap();
         }
     }
     
     void Tokenizer::scopeObject(Scope &scope,
-                                std::stringstream &stream,
-                                TokenizedPairs &pairs,
+                                Cursor &cursor,
+                                TokenSink &sink,
                                 TokenizerFeedback &feedback)
     {
         char token{(char) Token::UNDEFINED};
-        (stream >> std::ws).get(token);
-        if(token != (char) Token::UNDEFINED)
+        if(cursor.skipWhitespace().get(token))
         {
-            bool success{true};
             if(token == Token::OBJECT_END)
             {
-                pairs.emplace_back(TokenizedPair{.token = (Token)token,
-                                                 .value = std::string{token}});
+                sink.emit((Token) token, cursor.position - 1, 1);
 
-                // Remove value separator at the end of array
+                // Remove value separator at the end of object if present
                 char separator{(char) Token::UNDEFINED};
-                (stream >> std::ws).get(separator);
-                if (separator != (char)Token::UNDEFINED)
-                {
-                    if (separator != (char)Token::VALUE_END)
-                        success = false;
-                }
+                if(cursor.skipWhitespace().peek(separator) && (separator == (char)Token::VALUE_END))
+                    cursor.get(separator);
             }
-            if(!transitionRulesApplied(scope, (Token) token) || !success)
+            if(!transitionRulesApplied(scope, (Token) token))
             {
                 feedback.type = FeedbackType::NOK_PARSER_ERROR;
-                feedback.snap = stream.str();
+                feedback.snap = cursor.snap();
             }
         }
     }
 
     void Tokenizer::scopeKey(Scope &scope,
-                             std::stringstream &stream,
-                             TokenizedPairs &pairs,
+                             Cursor &cursor,
+                             TokenSink &sink,
                              TokenizerFeedback &feedback)
     {
-        std::string value {""};
-        bool success{true};
-        std::getline(stream, value, (char) Token::STRING_DELIMITER);
-        if(!stream.eof())
+        bool success{false};
+        const char *delimiter = cursor.findQuote();
+        if(delimiter < cursor.end)
         {
-            std::string residue {""};
-            std::getline(stream >> std::ws, residue, (char) Token::KEY_END);
-            if (!stream.eof())
-            {
-                char token{(char)Token::UNDEFINED};
-                (stream >> std::ws).get(token);
+            const StringView value {cursor.position, static_cast<std::size_t>(delimiter - cursor.position)};
+            cursor.position = delimiter + 1;
 
-                if (token != (char)Token::UNDEFINED)
+            // Only blank space may separate the key from its value separator
+            char token{(char)Token::UNDEFINED};
+            if (cursor.skipWhitespace().get(token) && (token == Token::KEY_END) &&
+                cursor.skipWhitespace().get(token))
+            {
+                // Check for NUMBER and LITERAL tokens
+                if (isDigit(token) || (token == (char) Token::MINUS_SIGN))
                 {
-                    // Check for NUMBER and LITERAL tokens
-                    if (std::isdigit(token) != 0)
-                    {
-                        // Write token back into stream since it is part of value
-                        stream.putback(token);
-                        token = (char)Token::NUMBER;
-                    }
-                    else
+                    // Write token back since it is part of value
+                    cursor.putback();
+                    token = (char)Token::NUMBER;
+                }
+                else
+                {
+                    switch (token)
                     {
-                        switch (token)
-                        {
-                        case (char)Token::LITERAL_NULL:
-                        case (char)Token::LITERAL_TRUE:
-                        case (char)Token::LITERAL_FALSE:
-                            stream.putback(token);
-                            token = (char)Token::LITERAL;
-                            break;
-                        default:
-                            break;
-                        }
+                    case (char)Token::LITERAL_NULL:
+                    case (char)Token::LITERAL_TRUE:
+                    case (char)Token::LITERAL_FALSE:
+                        cursor.putback();
+                        token = (char)Token::LITERAL;
+                        break;
+                    default:
+                        break;
                     }
+                }
 
-                    pairs.emplace_back(TokenizedPair{.token = Token::KEY,
-                                                     .value = value});
-                    success = transitionRulesApplied(scope, (Token)token);
-                    if(success)
+                sink.emit(Token::KEY, value.data(), value.size());
+                success = transitionRulesApplied(scope, (Token)token);
+                if(success)
+                {
+                    switch (token)
                     {
-                        switch (token)
-                        {
-                        case (char)Token::OBJECT_BEGIN:
-                        case (char)Token::ARRAY_BEGIN:
-                            pairs.emplace_back(TokenizedPair{.token = (Token) token,
-                                                             .value = std::string{token}});
-                            break;
-                        default:
-                            break;
-                        }
+                    case (char)Token::OBJECT_BEGIN:
+                    case (char)Token::ARRAY_BEGIN:
+                        sink.emit((Token) token, cursor.position - 1, 1);
+                        break;
+                    default:
+                        break;
                     }
                 }
             }
         }
-        if(stream.eof() || !success) 
+        if(!success) 
         {
             feedback.type = FeedbackType::NOK_PARSER_ERROR;
-            feedback.snap = stream.str();
+            feedback.snap = cursor.snap();
         }
     }
     
@@ -0,0 +1,289 @@
+#ifndef EJSON_SINK_H
+#define EJSON_SINK_H
+
+#include <iterator>
+#include "tokenizer.h"
+#include "handler.h"
+#include "scan.h"
+#include "symbols.h"
+
+/* ejson library namespace */
+namespace ejson
+{
+
+    /* Receiver of the tokens found by the scope handlers.
+       Values are handed over as a range of the file buffer being scanned. */
+    class TokenSink
+    {
+    public:
+        virtual ~TokenSink() = default;
+        virtual void emit(Token, const char *, std::size_t) = 0;
+
+        // NUMBER tokens come with their decoded value
+        virtual void emitNumber(const char *value, std::size_t length, const Number &)
+        {
+            emit(Token::NUMBER, value, length);
+        }
+
+        // Room for the tokens of the file body [begin, end) about to be scanned
+        virtual void reserve(const char *, const char *) {}
+
+        // Sink of its own for the tokens of a later chunk of the file, scanned by another worker
+        // and appended with join() in order; none if tokens must arrive in the order they are found
+        virtual std::unique_ptr<TokenSink> fork() { return nullptr; }
+        virtual void join(TokenSink &) {}
+    };
+
+    /* Counts the tokens passed on to another sink, for statistics */
+    class CountingSink : public TokenSink
+    {
+    private:
+        TokenSink &_sink;
+        std::size_t _count {0};
+
+    public:
+        explicit CountingSink(TokenSink &sink) : _sink{sink} {}
+        std::size_t count() const { return _count; }
+
+        void emit(Token token, const char *value, std::size_t length) override
+        {
+            ++_count;
+            _sink.emit(token, value, length);
+        }
+
+        void emitNumber(const char *value, std::size_t length, const Number &number) override
+        {
+            ++_count;
+            _sink.emitNumber(value, length, number);
+        }
+
+        void reserve(const char *begin, const char *end) override
+        {
+            _sink.reserve(begin, end);
+        }
+    };
+
+    /* Collects tokens as pairs owning a copy of their value */
+    class PairsSink : public TokenSink
+    {
+    private:
+        TokenizedPairs &_pairs;
+
+    public:
+        explicit PairsSink(TokenizedPairs &pairs) : _pairs{pairs} {}
+
+        void emit(Token token, const char *value, std::size_t length) override
+        {
+            _pairs.emplace_back(TokenizedPair{.token = token,
+                                              .value = std::string{value, length}});
+        }
+
+        void emitNumber(const char *value, std::size_t length, const Number &number) override
+        {
+            _pairs.emplace_back(TokenizedPair{.token = Token::NUMBER,
+                                              .value = std::string{value, length},
+                                              .number = number});
+        }
+
+        void reserve(const char *begin, const char *end) override
+        {
+            _pairs.reserve(_pairs.size() + SCAN_KERNELS.boundTokens(begin, end));
+        }
+
+        std::unique_ptr<TokenSink> fork() override;
+
+        void join(TokenSink &chunk) override
+        {
+            TokenizedPairs &pairs = static_cast<PairsSink &>(chunk)._pairs;
+            _pairs.insert(_pairs.end(), std::make_move_iterator(pairs.begin()), std::make_move_iterator(pairs.end()));
+        }
+    };
+
+    /* Pairs of one chunk of a file, see TokenSink::fork */
+    class ChunkPairsSink : public PairsSink
+    {
+    private:
+        TokenizedPairs _chunk_pairs {};
+
+    public:
+        ChunkPairsSink() : PairsSink{_chunk_pairs} {}
+    };
+
+    inline std::unique_ptr<TokenSink> PairsSink::fork()
+    {
+        return std::unique_ptr<TokenSink>{new ChunkPairsSink{}};
+    }
+
+    /* Collects tokens as pairs, with their keys interned instead of copied */
+    class SymbolPairsSink : public PairsSink
+    {
+    private:
+        TokenizedPairs &_pairs;
+        SymbolTable &_symbols;
+
+    public:
+        SymbolPairsSink(TokenizedPairs &pairs, SymbolTable &symbols) : PairsSink{pairs}, _pairs{pairs}, _symbols{symbols} {}
+
+        void emit(Token token, const char *value, std::size_t length) override
+        {
+            if(token != Token::KEY)
+                PairsSink::emit(token, value, length);
+            else
+                _pairs.emplace_back(TokenizedPair{.token = token,
+                                                  .symbol = _symbols.intern(StringView{value, length})});
+        }
+
+        // Symbols are numbered in the order keys are found
+        std::unique_ptr<TokenSink> fork() override { return nullptr; }
+    };
+
+    /* Collects tokens as offsets into the buffer they were found in */
+    class ViewsSink : public TokenSink
+    {
+    private:
+        TokenViews &_views;
+        const char *_base;
+
+    public:
+        ViewsSink(TokenViews &views, const char *base) : _views{views}, _base{base} {}
+
+        void emit(Token token, const char *value, std::size_t length) override
+        {
+            _views.emplace_back(TokenView{token,
+                                          static_cast<std::uint32_t>(value - _base),
+                                          static_cast<std::uint32_t>(length)});
+        }
+
+        void reserve(const char *begin, const char *end) override
+        {
+            _views.reserve(_views.size() + SCAN_KERNELS.boundTokens(begin, end));
+        }
+
+        std::unique_ptr<TokenSink> fork() override;
+
+        void join(TokenSink &chunk) override
+        {
+            const TokenViews &views = static_cast<ViewsSink &>(chunk)._views;
+            _views.insert(_views.end(), views.begin(), views.end());
+        }
+    };
+
+    /* Views of one chunk of a file, drawn from the heap while other workers scan */
+    class ChunkViewsSink : public ViewsSink
+    {
+    private:
+        TokenViews _chunk_views {};
+
+    public:
+        explicit ChunkViewsSink(const char *base) : ViewsSink{_chunk_views, base} {}
+    };
+
+    inline std::unique_ptr<TokenSink> ViewsSink::fork()
+    {
+        return std::unique_ptr<TokenSink>{new ChunkViewsSink{_base}};
+    }
+
+    /* Collects tokens as parallel arrays, matching the end of every container to its begin */
+    class ColumnsSink : public TokenSink
+    {
+    private:
+        TokenColumns &_columns;
+        const char *_base;
+        ArenaVector<std::uint32_t> _open;
+
+    public:
+        ColumnsSink(TokenColumns &columns, const char *base)
+            : _columns{columns}, _base{base}, _open{columns.matches.get_allocator()} {}
+
+        void emit(Token token, const char *value, std::size_t length) override
+        {
+            const std::uint32_t index = static_cast<std::uint32_t>(_columns.kinds.size());
+            _columns.kinds.push_back(static_cast<std::uint8_t>(token));
+            _columns.offsets.push_back(static_cast<std::uint32_t>(value - _base));
+            _columns.lengths.push_back(static_cast<std::uint32_t>(length));
+            _columns.matches.push_back(index);
+            switch (token)
+            {
+            case Token::OBJECT_BEGIN:
+            case Token::ARRAY_BEGIN:
+                _open.push_back(index);
+                break;
+            case Token::OBJECT_END:
+            case Token::ARRAY_END:
+                if(!_open.empty())
+                {
+                    _columns.matches[_open.back()] = index;
+                    _open.pop_back();
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        void reserve(const char *begin, const char *end) override
+        {
+            const std::size_t tokens = _columns.kinds.size() + SCAN_KERNELS.boundTokens(begin, end);
+            _columns.kinds.reserve(tokens);
+            _columns.offsets.reserve(tokens);
+            _columns.lengths.reserve(tokens);
+            _columns.matches.reserve(tokens);
+        }
+    };
+
+    /* Passes tokens on as events of a handler */
+    class HandlerSink : public TokenSink
+    {
+    private:
+        TokenHandler &_handler;
+
+    public:
+        explicit HandlerSink(TokenHandler &handler) : _handler{handler} {}
+
+        void emit(Token token, const char *value, std::size_t length) override
+        {
+            switch (token)
+            {
+            case Token::OBJECT_BEGIN:
+                _handler.onObjectBegin();
+                break;
+            case Token::OBJECT_END:
+                _handler.onObjectEnd();
+                break;
+            case Token::ARRAY_BEGIN:
+                _handler.onArrayBegin();
+                break;
+            case Token::ARRAY_END:
+                _handler.onArrayEnd();
+                break;
+            case Token::KEY:
+                _handler.onKey(StringView{value, length});
+                break;
+            case Token::STRING:
+                _handler.onString(StringView{value, length});
+                break;
+            case Token::NUMBER:
+            {
+                Number number {};
+                decodeNumber(StringView{value, length}, number);
+                _handler.onNumberValue(StringView{value, length}, number);
+                break;
+            }
+            case Token::LITERAL_NULL:
+            case Token::LITERAL_TRUE:
+            case Token::LITERAL_FALSE:
+                _handler.onLiteral(token, StringView{value, length});
+                break;
+            default:
+                break;
+            }
+        }
+
+        void emitNumber(const char *value, std::size_t length, const Number &number) override
+        {
+            _handler.onNumberValue(StringView{value, length}, number);
+        }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,229 @@
+#include "tokenizer.h"
+#include "scan.h"
+#include "sink.h"
+#include "threadpool.h"
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+
+namespace ejson
+{
+    // Position right after a comma outside of strings and comments, with the scopes open there
+    struct SplitPoint
+    {
+        std::size_t offset;
+        std::vector<unsigned char> scopes;
+    };
+
+    // Tokens of one chunk of a file, and the state its scan stopped in
+    struct Chunk
+    {
+        std::unique_ptr<TokenSink> sink {};
+        TokenizerFeedback feedback {};
+        const char *position {nullptr};
+        Scope scope {};
+        std::vector<unsigned char> scopes {};
+        std::size_t tokens {0};
+        std::size_t max_depth {0};
+    };
+
+    // Chunks of a file, claimed in order by the workers taking part. Workers may claim
+    // after the file is done, and only find that nothing is left.
+    struct ChunkGroup
+    {
+        std::vector<SplitPoint> points {};
+        std::vector<Chunk> chunks {};
+        std::atomic<std::size_t> next {1};
+        std::mutex mutex {};
+        std::condition_variable chunk_done {};
+        std::size_t done {0};
+    };
+
+    // Split points of the file body about split_size apart, found in one pass over its structure
+    // as for structural indexes. Between two structural characters there are neither strings nor
+    // comments, so any comma in between separates values.
+    static void findSplitPoints(const char *begin, const char *body, const char *end, std::size_t split_size,
+                                std::vector<SplitPoint> &points)
+    {
+        std::vector<unsigned char> scopes {ScopeType::SCOPE_EMPTY};
+        points.push_back(SplitPoint{static_cast<std::size_t>(body - begin), scopes});
+        const std::size_t size = static_cast<std::size_t>(end - begin);
+        std::size_t target = points.back().offset + split_size;
+        const char *gap = body;
+        const char *p = body;
+        // The last chunk takes the rest of the body, up to one and a half times the size
+        while(target + split_size / 2 < size)
+        {
+            p = SCAN_KERNELS.findStructure(p, end);
+            if(static_cast<std::size_t>(p - begin) >= target)
+            {
+                const char *from = std::max(gap, begin + target);
+                const void *comma = std::memchr(from, (char) Token::VALUE_END, p - from);
+                if(comma != nullptr)
+                {
+                    const char *point = static_cast<const char *>(comma) + 1;
+                    points.push_back(SplitPoint{static_cast<std::size_t>(point - begin), scopes});
+                    target = points.back().offset + split_size;
+                }
+            }
+            if(p == end)
+                return;
+            switch (*p)
+            {
+            case (char) Token::STRING_DELIMITER:
+                p = SCAN_KERNELS.findQuote(p + 1, end);
+                if(p == end)
+                    return;
+                break;
+            case (char) Token::COMMENT:
+            {
+                const void *line_end = std::memchr(p, (char) Token::NEW_LINE, end - p);
+                p = (line_end != nullptr) ? static_cast<const char *>(line_end) : (end - 1);
+                break;
+            }
+            case (char) Token::OBJECT_BEGIN:
+            case (char) Token::ARRAY_BEGIN:
+                // Deeper bodies are in error before they get there
+                if(scopes.size() + 1 == MAX_SCOPE_DEPTH)
+                    return;
+                scopes.push_back((*p == (char) Token::OBJECT_BEGIN) ? ScopeType::SCOPE_OBJECT : ScopeType::SCOPE_ARRAY);
+                break;
+            case (char) Token::OBJECT_END:
+            case (char) Token::ARRAY_END:
+                // Mismatches are left to the scan to report
+                if(scopes.size() == 1)
+                    return;
+                scopes.pop_back();
+                break;
+            default:
+                break;
+            }
+            gap = ++p;
+        }
+    }
+
+    void Tokenizer::restoreStack(const std::vector<unsigned char> &scopes)
+    {
+        _depth = 0;
+        _max_depth = 0;
+        for(unsigned char scope_type : scopes)
+            pushStack(static_cast<ScopeType>(scope_type));
+    }
+
+    const char *Tokenizer::generateChunk(const File &file, const char *begin, const char *end, Scope &scope,
+                                         TokenSink &sink, TokenizerFeedback &feedback)
+    {
+        // Scan from the end of a step on, with the scope stack in place, until a step ends at or after end
+        feedback.type = FeedbackType::OK;
+        Cursor cursor{file.buffer.begin(), begin, file.buffer.end()};
+        while (!cursor.eof() && (cursor.position < end) && (feedback.type == FeedbackType::OK))
+            scanStep(scope, cursor, sink, feedback);
+        return cursor.position;
+    }
+
+    bool Tokenizer::generateSplit(File &file, TokenSink &sink, TokenSink &target, std::size_t &split_tokens,
+                                  TokenizerFeedback &feedback)
+    {
+        // Chunks are scanned by the workers of the tokenizer owning this one, the first by this one
+        // into the target and the others into sinks of their own. The file is scanned in one piece
+        // if it is small, has no split points or the sink takes its tokens only in order.
+        Tokenizer &owner = *_owner;
+        const std::size_t split_size = _options.split_size;
+        if(!owner._pool || (split_size == 0) || (file.buffer.size() - file.body <= split_size))
+            return false;
+        std::unique_ptr<TokenSink> second = sink.fork();
+        if(!second)
+            return false;
+        const char *begin = file.buffer.begin();
+        std::shared_ptr<ChunkGroup> group = std::make_shared<ChunkGroup>();
+        findSplitPoints(begin, begin + file.body, file.buffer.end(), split_size, group->points);
+        const std::size_t count = group->points.size();
+        if(count < 2)
+            return false;
+        group->chunks.resize(count);
+        group->chunks[1].sink = std::move(second);
+        for(std::size_t index = 2; index < count; ++index)
+            group->chunks[index].sink = sink.fork();
+
+        // A chunk starts in the scope of the innermost container open at its split point
+        const File *split_file = &file;
+        const bool collect = collecting();
+        const bool presize = _options.presize_tokens;
+        auto scan = [group, split_file, collect, presize] (Tokenizer &worker)
+        {
+            std::size_t index;
+            while((index = group->next++) < group->chunks.size())
+            {
+                const SplitPoint &point = group->points[index];
+                Chunk &chunk = group->chunks[index];
+                const char *chunk_begin = split_file->buffer.begin() + point.offset;
+                const char *chunk_end = (index + 1 < group->points.size()) ? (split_file->buffer.begin() + group->points[index + 1].offset)
+                                                                            : split_file->buffer.end();
+                CountingSink counting_sink{*chunk.sink};
+                TokenSink &chunk_target = collect ? static_cast<TokenSink &>(counting_sink) : *chunk.sink;
+                if(presize)
+                    chunk_target.reserve(chunk_begin, chunk_end);
+                worker.restoreStack(point.scopes);
+                chunk.scope = Scope{static_cast<ScopeType>(point.scopes.back()), static_cast<ScopeType>(point.scopes.back())};
+                chunk.position = worker.generateChunk(*split_file, chunk_begin, chunk_end, chunk.scope, chunk_target, chunk.feedback);
+                chunk.scopes.assign(worker._last_begun, worker._last_begun + worker._depth);
+                chunk.tokens = counting_sink.count();
+                chunk.max_depth = worker._max_depth;
+                {
+                    std::lock_guard<std::mutex> lock{group->mutex};
+                    ++group->done;
+                }
+                group->chunk_done.notify_all();
+            }
+        };
+        for(std::size_t helper = 0; helper < std::min(count - 1, owner._pool->size()); ++helper)
+        {
+            owner._pool->submit([&owner, scan] (std::size_t worker)
+            {
+                scan(*owner._workers[worker]);
+            });
+        }
+
+        Chunk &first = group->chunks[0];
+        restoreStack(group->points[0].scopes);
+        first.position = generateChunk(file, begin + group->points[0].offset, begin + group->points[1].offset,
+                                       first.scope, target, first.feedback);
+        first.scopes.assign(_last_begun, _last_begun + _depth);
+        first.max_depth = _max_depth;
+        // Claimed chunks are being scanned, this one waits for them only after claiming the rest
+        scan(*this);
+        {
+            std::unique_lock<std::mutex> lock{group->mutex};
+            group->chunk_done.wait(lock, [&group, count] { return group->done == count - 1; });
+        }
+
+        // The first chunk starts where the body does. A chunk is joined once the one before it
+        // ended at its split point, in the scopes it started in; the tokens it holds are then
+        // those of the file in one piece. Otherwise the scan goes on from where the chunk
+        // before stopped, and the chunks after it are dropped.
+        std::size_t max_depth = first.max_depth;
+        for(std::size_t index = 0; ; ++index)
+        {
+            Chunk &chunk = group->chunks[index];
+            if(index > 0)
+            {
+                sink.join(*chunk.sink);
+                split_tokens += chunk.tokens;
+                max_depth = std::max(max_depth, chunk.max_depth);
+            }
+            feedback = chunk.feedback;
+            if((feedback.type != FeedbackType::OK) || (index + 1 == count))
+                break;
+            const SplitPoint &next = group->points[index + 1];
+            if((chunk.position != begin + next.offset) || (chunk.scope.current != next.scopes.back()) || (chunk.scopes != next.scopes))
+            {
+                restoreStack(chunk.scopes);
+                generateChunk(file, chunk.position, file.buffer.end(), chunk.scope, target, feedback);
+                max_depth = std::max(max_depth, _max_depth);
+                break;
+            }
+        }
+        _max_depth = max_depth;
+        return true;
+    }
+}
\ No newline at end of file
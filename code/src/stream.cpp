@@ -0,0 +1,183 @@
+#include "stream.h"
+#include "scan.h"
+#include "sink.h"
+#include <vector>
+#include <cstring>
+
+namespace ejson
+{
+    // Input kept before the scanning position, for the line shown in feedback snapshots
+    static const std::size_t SNAP_CONTEXT = 256;
+
+    /* Holds back the tokens of a scanning step until the step is known to be final */
+    class StepSink : public TokenSink
+    {
+    private:
+        struct Emitted
+        {
+            Token token;
+            const char *value;
+            std::size_t length;
+            Number number;
+        };
+        std::vector<Emitted> _emitted {};
+
+    public:
+        void emit(Token token, const char *value, std::size_t length) override
+        {
+            _emitted.emplace_back(Emitted{token, value, length, Number{}});
+        }
+
+        void emitNumber(const char *value, std::size_t length, const Number &number) override
+        {
+            _emitted.emplace_back(Emitted{Token::NUMBER, value, length, number});
+        }
+
+        void commit(TokenSink &sink)
+        {
+            for(const Emitted &emitted : _emitted)
+            {
+                if(emitted.token == Token::NUMBER)
+                    sink.emitNumber(emitted.value, emitted.length, emitted.number);
+                else
+                    sink.emit(emitted.token, emitted.value, emitted.length);
+            }
+            _emitted.clear();
+        }
+
+        void discard()
+        {
+            _emitted.clear();
+        }
+    };
+
+    StreamTokenizer::StreamTokenizer(TokenHandler &handler, MemoryResource *resource)
+        : _tokenizer{resource},
+          _handler{handler},
+          _pending{resource},
+          _imports{resource}
+    {
+    }
+
+    TokenizerFeedback StreamTokenizer::feed(const char *data, std::size_t size)
+    {
+        if(!_finished && (_feedback.type == FeedbackType::OK))
+        {
+            compact();
+            _pending.append(data, size);
+            scanHeader();
+            scanBody();
+        }
+        return _feedback;
+    }
+
+    TokenizerFeedback StreamTokenizer::finish()
+    {
+        if(!_finished && (_feedback.type == FeedbackType::OK))
+        {
+            _finished = true;
+            scanHeader();
+            scanBody();
+        }
+        return _feedback;
+    }
+
+    void StreamTokenizer::reset()
+    {
+        _tokenizer._depth = 0;
+        _pending.clear();
+        _position = 0;
+        _scope = Scope{};
+        _body = false;
+        _finished = false;
+        _feedback = TokenizerFeedback{};
+        _imports.clear();
+    }
+
+    void StreamTokenizer::scanHeader()
+    {
+        // Import statements are handled by complete lines, up to the line beginning the body
+        const char *begin = _pending.data();
+        const char *end = begin + _pending.size();
+        const ArenaString home {_pending.get_allocator()};
+        while(!_body && (_feedback.type == FeedbackType::OK))
+        {
+            const char *position = begin + _position;
+            while((position < end) && isWhitespace(*position))
+                ++position;
+            _position = position - begin;
+            if(position == end)
+                return;
+            if(*position == (char) Token::OBJECT_BEGIN)
+            {
+                _body = true;
+                _tokenizer.pushStack(_scope.current);
+                return;
+            }
+
+            const void *found = std::memchr(position, (char) Token::NEW_LINE, end - position);
+            if((found == nullptr) && !_finished)
+                return;
+            const char *line_end = (found != nullptr) ? static_cast<const char *>(found) : end;
+            const void *first_comment = std::memchr(position, (char) Token::COMMENT, line_end - position);
+            const char *line_last = (first_comment != nullptr) ? static_cast<const char *>(first_comment) : line_end;
+            if(line_last > position)
+                _tokenizer.checkForAndParseImportStatement(home,
+                                                           StringView{position, static_cast<std::size_t>(line_last - position)},
+                                                           _imports,
+                                                           _feedback);
+            _position = line_end - begin;
+        }
+    }
+
+    void StreamTokenizer::scanBody()
+    {
+        if(!_body || (_feedback.type != FeedbackType::OK))
+            return;
+
+        HandlerSink sink{_handler};
+        StepSink step_sink{};
+        Cursor cursor{_pending.data(), _pending.data() + _position, _pending.data() + _pending.size()};
+        while(!cursor.eof() && (_feedback.type == FeedbackType::OK))
+        {
+            const char *start = cursor.position;
+            const Scope scope = _scope;
+            const std::size_t depth = _tokenizer._depth;
+            TokenizerFeedback step_feedback{};
+            _tokenizer.scanStep(_scope, cursor, step_sink, step_feedback);
+
+            // A step that ran into the end of the input so far may turn out differently
+            // with more input: it is undone and repeated once the next chunk arrives.
+            // Strings and keys run into the end while searching their closing delimiter.
+            const bool incomplete = !_finished &&
+                                    (cursor.eof() ||
+                                     ((step_feedback.type != FeedbackType::OK) &&
+                                      ((scope.current == ScopeType::SCOPE_STRING) || (scope.current == ScopeType::SCOPE_KEY)) &&
+                                      (SCAN_KERNELS.findQuote(start, cursor.end) == cursor.end)));
+            if(incomplete)
+            {
+                step_sink.discard();
+                _scope = scope;
+                // A step pushes or pops one scope at most, popped entries stay in place
+                _tokenizer._depth = depth;
+                break;
+            }
+
+            step_sink.commit(sink);
+            _position = cursor.position - cursor.begin;
+            if(step_feedback.type != FeedbackType::OK)
+                _feedback = step_feedback;
+        }
+    }
+
+    void StreamTokenizer::compact()
+    {
+        // Drop the scanned input, except for the beginning of the line being scanned
+        const std::size_t limit = (_position > SNAP_CONTEXT) ? (_position - SNAP_CONTEXT) : 0;
+        std::size_t keep = _position;
+        while((keep > limit) && (_pending[keep - 1] != (char) Token::NEW_LINE))
+            --keep;
+        _pending.erase(0, keep);
+        _position -= keep;
+    }
+}
\ No newline at end of file
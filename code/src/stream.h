@@ -0,0 +1,51 @@
+#ifndef EJSON_STREAM_H
+#define EJSON_STREAM_H
+
+#include <cstddef>
+#include "tokenizer.h"
+#include "handler.h"
+
+/* ejson library namespace */
+namespace ejson
+{
+
+    /* Tokenizer for eJSON arriving in chunks of any size, e.g. from a pipe or a socket.
+       Tokens are passed on to the handler as soon as they are complete, a token split
+       across chunks is completed with the chunks that follow. Only the unfinished part
+       of the input is kept. Import statements are collected, but not resolved. */
+    class StreamTokenizer
+    {
+    private:
+        Tokenizer _tokenizer;
+        TokenHandler &_handler;
+        ArenaString _pending;
+        std::size_t _position {0};
+        Scope _scope {};
+        bool _body {false};
+        bool _finished {false};
+        TokenizerFeedback _feedback {};
+        ListOfFileNames _imports;
+        void scanHeader();
+        void scanBody();
+        void compact();
+
+    public:
+        explicit StreamTokenizer(TokenHandler &, MemoryResource * = newDeleteResource());
+        StreamTokenizer(const StreamTokenizer &) = delete;
+        StreamTokenizer &operator=(const StreamTokenizer &) = delete;
+
+        // Tokenize the next chunk of input, nothing is tokenized after an error
+        TokenizerFeedback feed(const char *, std::size_t);
+
+        // Tokenize what remains once the input is complete
+        TokenizerFeedback finish();
+
+        // Prepare for another input
+        void reset();
+
+        // Files named by the import statements so far, as written
+        const ListOfFileNames &imports() const { return _imports; }
+    };
+}
+
+#endif
\ No newline at end of file
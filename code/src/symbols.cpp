@@ -0,0 +1,170 @@
+#include "symbols.h"
+#include "sink.h"
+#include "cache.h"
+
+namespace ejson
+{
+    static const std::size_t INITIAL_SLOTS = 64;
+
+    // FNV-1a, as for the file index of import resolution
+    static std::uint32_t hashOf(StringView name)
+    {
+        std::uint32_t hash {2166136261u};
+        for(char c : name)
+            hash = (hash ^ (unsigned char) c) * 16777619u;
+        return hash;
+    }
+
+    SymbolTable::SymbolTable(MemoryResource *resource)
+        : _pool{resource}, _ends{resource}, _hashes{resource}, _slots{resource}
+    {
+    }
+
+    std::size_t SymbolTable::slotOf(StringView name, std::uint32_t hash) const
+    {
+        // The slot of the name, or the free slot it would take
+        const std::size_t mask = _slots.size() - 1;
+        std::size_t slot = hash & mask;
+        while(_slots[slot] != 0)
+        {
+            const std::uint32_t symbol = _slots[slot] - 1;
+            if((_hashes[symbol] == hash) && (this->name(symbol) == name))
+                break;
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void SymbolTable::grow()
+    {
+        // Kept at most half full, slots are rebuilt from the stored hashes
+        _slots.assign(_slots.empty() ? INITIAL_SLOTS : (_slots.size() * 2), 0);
+        const std::size_t mask = _slots.size() - 1;
+        for(std::uint32_t symbol = 0; symbol < _hashes.size(); ++symbol)
+        {
+            std::size_t slot = _hashes[symbol] & mask;
+            while(_slots[slot] != 0)
+                slot = (slot + 1) & mask;
+            _slots[slot] = symbol + 1;
+        }
+    }
+
+    std::uint32_t SymbolTable::intern(StringView name)
+    {
+        if(2 * (_ends.size() + 1) > _slots.size())
+            grow();
+        const std::uint32_t hash = hashOf(name);
+        const std::size_t slot = slotOf(name, hash);
+        if(_slots[slot] != 0)
+            return _slots[slot] - 1;
+
+        const std::uint32_t symbol = static_cast<std::uint32_t>(_ends.size());
+        _pool.append(name.data(), name.size());
+        _ends.push_back(static_cast<std::uint32_t>(_pool.size()));
+        _hashes.push_back(hash);
+        _slots[slot] = symbol + 1;
+        return symbol;
+    }
+
+    std::uint32_t SymbolTable::find(StringView name) const
+    {
+        if(_slots.empty())
+            return NO_SYMBOL;
+        const std::size_t slot = slotOf(name, hashOf(name));
+        return (_slots[slot] != 0) ? (_slots[slot] - 1) : NO_SYMBOL;
+    }
+
+    void SymbolTable::clear()
+    {
+        _pool.clear();
+        _ends.clear();
+        _hashes.clear();
+        _slots.clear();
+    }
+
+    TokenizerFeedback Tokenizer::tokenize(const std::string &input_file,
+                                          ListOfTokenizedPairs &list_of_tokenized_pairs,
+                                          SymbolTable &symbols)
+    {
+        // Initialize tokenization and generate tokens for every file listed. Serially generated files
+        // intern their keys into the given table in turn. Concurrently generated files intern them into
+        // tables of their own, merged in the order of the files, so that symbols do not depend on the workers.
+        const std::chrono::steady_clock::time_point begin = beginStatistics();
+        beginScratch(false);
+        ListOfFiles list_of_files{scratch()};
+        TokenizerFeedback feedback{};
+        std::deque<TokenizedPairs, PolymorphicAllocator<TokenizedPairs>> staged_pairs{scratch()};
+        std::deque<SymbolTable, PolymorphicAllocator<SymbolTable>> staged_symbols{scratch()};
+        const ArenaString root {input_file.data(), input_file.size(), scratch()};
+        std::size_t count = generateAll(&root, &root + 1,
+                                        list_of_files,
+                                        [this, &staged_pairs, &staged_symbols, &symbols] (File &file) -> FileTask
+        {
+            staged_pairs.emplace_back(sparePairs());
+            TokenizedPairs &pairs = staged_pairs.back();
+            if(_pool)
+                staged_symbols.emplace_back(_resource);
+            SymbolTable &file_symbols = _pool ? staged_symbols.back() : symbols;
+            return [this, &file, &pairs, &file_symbols] (Tokenizer &worker, TokenizerFeedback &file_feedback)
+            {
+                // Cached pairs hold the names of their keys, as for calls without interning
+                if(file.cached && file.cached->complete)
+                {
+                    pairs = file.cached->pairs;
+                    for(TokenizedPair &pair : pairs)
+                    {
+                        if(pair.token != Token::KEY)
+                            continue;
+                        pair.symbol = file_symbols.intern(StringView{pair.value.data(), pair.value.size()});
+                        std::string{}.swap(pair.value);
+                    }
+                    file.statistics.tokens = pairs.size();
+                    return;
+                }
+                if(openFile(file, file_feedback))
+                {
+                    SymbolPairsSink sink{pairs, file_symbols};
+                    worker.generateTokens(file, sink, file_feedback);
+                }
+                closeFile(file);
+
+                if(file.cached && (file_feedback.type == FeedbackType::OK))
+                {
+                    file.cached->pairs = pairs;
+                    for(TokenizedPair &pair : file.cached->pairs)
+                    {
+                        if(pair.token != Token::KEY)
+                            continue;
+                        pair.value = file_symbols.name(pair.symbol).str();
+                        pair.symbol = NO_SYMBOL;
+                    }
+                    file.cached->complete = true;
+                    _options.token_cache->insert(file.cached);
+                }
+            };
+        }, feedback);
+
+        // Symbols of concurrently generated files are renumbered into the given table
+        ArenaVector<std::uint32_t> renumbered{scratch()};
+        for(std::size_t index = 0; (index < count) && _pool; ++index)
+        {
+            const SymbolTable &file_symbols = staged_symbols[index];
+            renumbered.clear();
+            for(std::uint32_t symbol = 0; symbol < file_symbols.size(); ++symbol)
+                renumbered.push_back(symbols.intern(file_symbols.name(symbol)));
+            for(TokenizedPair &pair : staged_pairs[index])
+            {
+                if(pair.token == Token::KEY)
+                    pair.symbol = renumbered[pair.symbol];
+            }
+        }
+        std::move(std::begin(staged_pairs), std::begin(staged_pairs) + count,
+                  std::back_inserter(list_of_tokenized_pairs));
+
+        // Cleanup
+        endStatistics(list_of_files, begin);
+        cleanup(list_of_files);
+
+        return feedback;
+    }
+}
\ No newline at end of file
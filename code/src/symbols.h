@@ -0,0 +1,48 @@
+#ifndef EJSON_SYMBOLS_H
+#define EJSON_SYMBOLS_H
+
+#include <cstdint>
+#include <cstddef>
+#include "tokenizer.h"
+#include "memory.h"
+
+/* ejson library namespace */
+namespace ejson
+{
+
+    /* Interned keys, numbered densely from 0 in the order they are first interned.
+       Every name is held once in a pool, however often it occurs; a symbol is valid
+       for as long as the table is not cleared. Lookups are not synchronized. */
+    class SymbolTable
+    {
+    private:
+        ArenaString _pool;
+        ArenaVector<std::uint32_t> _ends;
+        ArenaVector<std::uint32_t> _hashes;
+        // Open addressing over a power of two slots, each the symbol plus one or 0 if free
+        ArenaVector<std::uint32_t> _slots;
+        std::size_t slotOf(StringView, std::uint32_t) const;
+        void grow();
+
+    public:
+        explicit SymbolTable(MemoryResource * = newDeleteResource());
+
+        // Symbol of the name, added if it is new
+        std::uint32_t intern(StringView);
+
+        // Symbol of the name, NO_SYMBOL if it was never interned
+        std::uint32_t find(StringView) const;
+
+        StringView name(std::uint32_t symbol) const
+        {
+            const std::uint32_t begin = (symbol > 0) ? _ends[symbol - 1] : 0;
+            return StringView{_pool.data() + begin, _ends[symbol] - begin};
+        }
+
+        std::size_t size() const { return _ends.size(); }
+        bool empty() const { return _ends.empty(); }
+        void clear();
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,215 @@
+#include "tape.h"
+#include "provider.h"
+#include <fstream>
+#include <vector>
+#include <limits>
+#include <cstdio>
+#include <cstring>
+
+namespace ejson
+{
+    static const char TAPE_MAGIC[8] = {'E', 'J', 'S', 'O', 'N', 'T', 'P', '\0'};
+    static const std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+    static const std::uint64_t SECTION_ALIGNMENT = 8;
+    static const char *const TEMPORARY_SUFFIX = ".tmp";
+
+    static std::uint64_t aligned(std::uint64_t offset)
+    {
+        return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+    }
+
+    // A section of count elements of the given size at offset lies within the tape
+    static bool fits(std::uint64_t offset, std::uint64_t count, std::uint64_t size, std::uint64_t tape_size)
+    {
+        return (offset <= tape_size) && (count <= (tape_size - offset) / size);
+    }
+
+    TokenizerFeedback Tokenizer::tokenize(const std::string &input_file,
+                                          TokenTape &token_tape,
+                                          const std::string &tape_file)
+    {
+        // A current tape of the same root file is used as it is
+        TokenizerFeedback feedback{};
+        if(token_tape.load(tape_file.c_str()) && (token_tape.size() > 0) &&
+           (token_tape.path(0) == StringView{input_file.data(), input_file.size()}) && token_tape.current(*_provider))
+            return feedback;
+
+        // Otherwise the files are tokenized from text and their tape is written anew
+        token_tape.clear();
+        ListOfTokenizedFiles list_of_tokenized_files{_resource};
+        feedback = tokenize(input_file, list_of_tokenized_files);
+        if((feedback.type == FeedbackType::OK) &&
+           !(writeTokenTape(tape_file, list_of_tokenized_files) && token_tape.load(tape_file.c_str())))
+        {
+            feedback.type = FeedbackType::NOK_FILE_ERROR;
+            feedback.file = tape_file;
+        }
+        return feedback;
+    }
+
+    bool TokenTape::load(const char *tape_file)
+    {
+        clear();
+        if(!_buffer.load(tape_file))
+            return false;
+
+        // Check the header, then that every section, path and value lies within the tape
+        const std::uint64_t size = _buffer.size();
+        const TapeHeader *header = reinterpret_cast<const TapeHeader *>(_buffer.begin());
+        bool valid = (size >= sizeof(TapeHeader)) &&
+                     (reinterpret_cast<std::uintptr_t>(_buffer.begin()) % SECTION_ALIGNMENT == 0) &&
+                     (std::memcmp(header->magic, TAPE_MAGIC, sizeof(TAPE_MAGIC)) == 0) &&
+                     (header->version == TAPE_VERSION) &&
+                     (header->byte_order == BYTE_ORDER_MARK) &&
+                     (header->size == size) &&
+                     (header->files % SECTION_ALIGNMENT == 0) &&
+                     (header->offsets % SECTION_ALIGNMENT == 0) &&
+                     (header->lengths % SECTION_ALIGNMENT == 0) &&
+                     fits(header->files, header->file_count, sizeof(TapeFile), size) &&
+                     fits(header->kinds, header->token_count, sizeof(char), size) &&
+                     fits(header->offsets, header->token_count, sizeof(std::uint32_t), size) &&
+                     fits(header->lengths, header->token_count, sizeof(std::uint32_t), size) &&
+                     fits(header->pool, header->pool_size, sizeof(char), size);
+        if(!valid)
+        {
+            clear();
+            return false;
+        }
+
+        _header = header;
+        _files = reinterpret_cast<const TapeFile *>(_buffer.begin() + header->files);
+        _kinds = _buffer.begin() + header->kinds;
+        _offsets = reinterpret_cast<const std::uint32_t *>(_buffer.begin() + header->offsets);
+        _lengths = reinterpret_cast<const std::uint32_t *>(_buffer.begin() + header->lengths);
+        _pool = _buffer.begin() + header->pool;
+        for(std::uint64_t file = 0; valid && (file < header->file_count); ++file)
+        {
+            const TapeFile &entry = _files[file];
+            valid = (static_cast<std::uint64_t>(entry.path_offset) + entry.path_length <= header->pool_size) &&
+                    (entry.first_token <= header->token_count) &&
+                    (entry.token_count <= header->token_count - entry.first_token);
+        }
+        for(std::uint64_t index = 0; valid && (index < header->token_count); ++index)
+            valid = (static_cast<std::uint64_t>(_offsets[index]) + _lengths[index] <= header->pool_size);
+        if(!valid)
+            clear();
+        return valid;
+    }
+
+    void TokenTape::clear()
+    {
+        _buffer = FileBuffer{};
+        _header = nullptr;
+        _files = nullptr;
+        _kinds = nullptr;
+        _offsets = nullptr;
+        _lengths = nullptr;
+        _pool = nullptr;
+    }
+
+    bool TokenTape::current(const FileProvider &provider) const
+    {
+        for(std::size_t file = 0; file < size(); ++file)
+        {
+            FileStamp stamp{};
+            if(!provider.stamp(path(file).str().c_str(), stamp) || (stamp != _files[file].stamp))
+                return false;
+        }
+        return !empty();
+    }
+
+    void TokenTape::copyTo(ListOfTokenizedPairs &list_of_tokenized_pairs) const
+    {
+        for(std::size_t file = 0; file < size(); ++file)
+        {
+            list_of_tokenized_pairs.emplace_back();
+            TokenizedPairs &pairs = list_of_tokenized_pairs.back();
+            pairs.reserve(tokenCount(file));
+            const std::size_t end = firstToken(file) + tokenCount(file);
+            for(std::size_t index = firstToken(file); index < end; ++index)
+            {
+                pairs.emplace_back(TokenizedPair{.token = token(index),
+                                                 .value = value(index).str()});
+                if(pairs.back().token == Token::NUMBER)
+                    decodeNumber(value(index), pairs.back().number);
+            }
+        }
+    }
+
+    bool writeTokenTape(const std::string &tape_file, const ListOfTokenizedFiles &list_of_tokenized_files)
+    {
+        // Lay out the file table and the string pool, paths precede the values of their file
+        TapeHeader header{};
+        std::memcpy(header.magic, TAPE_MAGIC, sizeof(TAPE_MAGIC));
+        header.version = TAPE_VERSION;
+        header.byte_order = BYTE_ORDER_MARK;
+        header.file_count = list_of_tokenized_files.size();
+        std::vector<TapeFile> files;
+        files.reserve(list_of_tokenized_files.size());
+        std::vector<std::uint32_t> offsets;
+        std::vector<std::uint32_t> lengths;
+        std::string kinds;
+        for(const TokenizedFile &file : list_of_tokenized_files)
+        {
+            if(header.pool_size + file.path.size() > std::numeric_limits<std::uint32_t>::max())
+                return false;
+            files.emplace_back(TapeFile{static_cast<std::uint32_t>(header.pool_size),
+                                        static_cast<std::uint32_t>(file.path.size()),
+                                        header.token_count,
+                                        file.views.size(),
+                                        file.buffer.stamp()});
+            header.pool_size += file.path.size();
+            header.token_count += file.views.size();
+            for(const TokenView &view : file.views)
+            {
+                if(header.pool_size + view.length > std::numeric_limits<std::uint32_t>::max())
+                    return false;
+                kinds.push_back(static_cast<char>(view.token));
+                offsets.push_back(static_cast<std::uint32_t>(header.pool_size));
+                lengths.push_back(view.length);
+                header.pool_size += view.length;
+            }
+        }
+        header.files = aligned(sizeof(TapeHeader));
+        header.kinds = header.files + header.file_count * sizeof(TapeFile);
+        header.offsets = aligned(header.kinds + header.token_count);
+        header.lengths = aligned(header.offsets + header.token_count * sizeof(std::uint32_t));
+        header.pool = aligned(header.lengths + header.token_count * sizeof(std::uint32_t));
+        header.size = header.pool + header.pool_size;
+
+        // Write to a temporary file first, so that readers never see a partial tape
+        const std::string temporary_file = tape_file + TEMPORARY_SUFFIX;
+        std::ofstream stream{temporary_file, std::ios::binary | std::ios::trunc};
+        const char padding[SECTION_ALIGNMENT] = {};
+        auto pad = [&stream, &padding] (std::uint64_t offset)
+        {
+            stream.write(padding, static_cast<std::streamsize>(aligned(offset) - offset));
+        };
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(TapeHeader));
+        pad(sizeof(TapeHeader));
+        stream.write(reinterpret_cast<const char *>(files.data()),
+                     static_cast<std::streamsize>(files.size() * sizeof(TapeFile)));
+        stream.write(kinds.data(), static_cast<std::streamsize>(kinds.size()));
+        pad(header.kinds + header.token_count);
+        stream.write(reinterpret_cast<const char *>(offsets.data()),
+                     static_cast<std::streamsize>(offsets.size() * sizeof(std::uint32_t)));
+        pad(header.offsets + header.token_count * sizeof(std::uint32_t));
+        stream.write(reinterpret_cast<const char *>(lengths.data()),
+                     static_cast<std::streamsize>(lengths.size() * sizeof(std::uint32_t)));
+        pad(header.lengths + header.token_count * sizeof(std::uint32_t));
+        for(const TokenizedFile &file : list_of_tokenized_files)
+        {
+            stream.write(file.path.data(), static_cast<std::streamsize>(file.path.size()));
+            for(const TokenView &view : file.views)
+                stream.write(file.buffer.begin() + view.offset, view.length);
+        }
+        stream.close();
+
+        if(stream.fail() || (std::rename(temporary_file.c_str(), tape_file.c_str()) != 0))
+        {
+            std::remove(temporary_file.c_str());
+            return false;
+        }
+        return true;
+    }
+}
\ No newline at end of file
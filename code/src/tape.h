@@ -0,0 +1,90 @@
+#ifndef EJSON_TAPE_H
+#define EJSON_TAPE_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include "tokenizer.h"
+#include "buffer.h"
+
+/* ejson library namespace */
+namespace ejson
+{
+
+    /* Layout of a token tape, the binary serialization of tokenized files.
+       A tape holds, in native byte order: the header, the file table, one kind per token,
+       the offsets and lengths of the token values, and the string pool with paths and values.
+       Sections are aligned to 8 bytes from the beginning of the tape. */
+    static const std::uint32_t TAPE_VERSION = 1;
+
+    struct TapeHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byte_order;
+        std::uint64_t size;
+        std::uint64_t file_count;
+        std::uint64_t token_count;
+        std::uint64_t pool_size;
+        std::uint64_t files;
+        std::uint64_t kinds;
+        std::uint64_t offsets;
+        std::uint64_t lengths;
+        std::uint64_t pool;
+    };
+    struct TapeFile
+    {
+        std::uint32_t path_offset;
+        std::uint32_t path_length;
+        std::uint64_t first_token;
+        std::uint64_t token_count;
+        FileStamp stamp;
+    };
+
+    /* Token tape loaded for reading. Tokens are read in place from the loaded tape,
+       without an allocation per token; tokens of all files are numbered consecutively. */
+    class TokenTape
+    {
+    private:
+        FileBuffer _buffer {};
+        const TapeHeader *_header {nullptr};
+        const TapeFile *_files {nullptr};
+        const char *_kinds {nullptr};
+        const std::uint32_t *_offsets {nullptr};
+        const std::uint32_t *_lengths {nullptr};
+        const char *_pool {nullptr};
+
+    public:
+        TokenTape() = default;
+        TokenTape(const TokenTape &) = delete;
+        TokenTape &operator=(const TokenTape &) = delete;
+
+        // Fails for missing and malformed tapes, and for tapes of another version
+        bool load(const char *);
+        void clear();
+
+        // True if no file changed since its tokens were written, by the stamps of the given provider
+        bool current(const FileProvider &) const;
+
+        bool empty() const { return _header == nullptr; }
+        std::size_t size() const { return (_header != nullptr) ? _header->file_count : 0; }
+        StringView path(std::size_t file) const
+        {
+            return StringView{_pool + _files[file].path_offset, _files[file].path_length};
+        }
+        std::size_t firstToken(std::size_t file) const { return _files[file].first_token; }
+        std::size_t tokenCount(std::size_t file) const { return _files[file].token_count; }
+        Token token(std::size_t index) const { return static_cast<Token>(_kinds[index]); }
+        StringView value(std::size_t index) const
+        {
+            return StringView{_pool + _offsets[index], _lengths[index]};
+        }
+
+        void copyTo(ListOfTokenizedPairs &) const;
+    };
+
+    // Write the tape of the given files, replacing the tape file only once it is complete
+    bool writeTokenTape(const std::string &, const ListOfTokenizedFiles &);
+}
+
+#endif
\ No newline at end of file
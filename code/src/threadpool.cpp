@@ -0,0 +1,83 @@
+#include "threadpool.h"
+#include <utility>
+
+namespace ejson
+{
+    ThreadPool::ThreadPool(std::size_t threads)
+    {
+        if(threads == 0)
+            threads = 1;
+        _threads.reserve(threads);
+        for(std::size_t index = 0; index < threads; ++index)
+            _threads.emplace_back([this, index] { run(index); });
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _stopping = true;
+        }
+        _work_available.notify_all();
+        for(std::thread &thread : _threads)
+            thread.join();
+    }
+
+    void ThreadPool::submit(Task task)
+    {
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _tasks.emplace_back(std::move(task));
+            ++_pending;
+        }
+        _work_available.notify_one();
+    }
+
+    void ThreadPool::wait()
+    {
+        std::unique_lock<std::mutex> lock{_mutex};
+        _work_done.wait(lock, [this] { return _pending == 0; });
+    }
+
+    void ThreadPool::run(std::size_t index)
+    {
+        while(true)
+        {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock{_mutex};
+                _work_available.wait(lock, [this] { return _stopping || !_tasks.empty(); });
+                if(_tasks.empty())
+                    return;
+                task = std::move(_tasks.front());
+                _tasks.pop_front();
+            }
+
+            task(index);
+
+            bool finished{false};
+            {
+                std::lock_guard<std::mutex> lock{_mutex};
+                finished = (--_pending == 0);
+            }
+            if(finished)
+                _work_done.notify_all();
+        }
+    }
+
+    void Semaphore::acquire()
+    {
+        std::unique_lock<std::mutex> lock{_mutex};
+        _released.wait(lock, [this] { return _available > 0; });
+        --_available;
+    }
+
+    void Semaphore::release()
+    {
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            ++_available;
+        }
+        _released.notify_one();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef EJSON_THREADPOOL_H
+#define EJSON_THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstddef>
+
+/* ejson library namespace */
+namespace ejson
+{
+
+    /* Fixed set of worker threads running submitted tasks.
+       Each task is told the index of the worker running it, so that
+       callers can keep per-worker state without further locking. */
+    class ThreadPool
+    {
+    public:
+        typedef std::function<void(std::size_t)> Task;
+
+    private:
+        std::vector<std::thread> _threads {};
+        std::deque<Task> _tasks {};
+        std::mutex _mutex {};
+        std::condition_variable _work_available {};
+        std::condition_variable _work_done {};
+        std::size_t _pending {0};
+        bool _stopping {false};
+        void run(std::size_t);
+
+    public:
+        explicit ThreadPool(std::size_t);
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+        ~ThreadPool();
+
+        std::size_t size() const { return _threads.size(); }
+        void submit(Task);
+
+        // Block until all submitted tasks have finished
+        void wait();
+    };
+
+    /* Counting semaphore bounding the number of threads
+       holding a resource at the same time */
+    class Semaphore
+    {
+    private:
+        std::mutex _mutex {};
+        std::condition_variable _released {};
+        std::size_t _available;
+
+    public:
+        explicit Semaphore(std::size_t available) : _available{available} {}
+        Semaphore(const Semaphore &) = delete;
+        Semaphore &operator=(const Semaphore &) = delete;
+
+        void acquire();
+        void release();
+    };
+}
+
+#endif
\ No newline at end of file
@@ -1,122 +1,611 @@
 #include "tokenizer.h"
+#include "scan.h"
+#include "sink.h"
+#include "threadpool.h"
+#include "cache.h"
+#include "provider.h"
+#include "readahead.h"
 #include <iostream>
 #include <algorithm>
+#include <iterator>
 #include <limits>
 #include <cctype>
 
 namespace ejson {
 
+    // Size of the first chunk of scratch memory of a tokenizer retaining it
+    static const std::size_t INITIAL_SCRATCH = 64 * 1024;
+
+    Tokenizer::Tokenizer() : Tokenizer{TokenizerOptions{}, newDeleteResource()}
+    {
+    }
+
+    Tokenizer::Tokenizer(MemoryResource *resource) : Tokenizer{TokenizerOptions{}, resource}
+    {
+    }
+
+    Tokenizer::Tokenizer(const TokenizerOptions &options, MemoryResource *resource)
+        : _options{options},
+          _resource{resource},
+          _provider{(options.file_provider != nullptr) ? options.file_provider : fileSystemProvider()},
+          _owner{this},
+          _contents{resource}
+    {
+        if(_options.worker_threads == 0)
+            _options.worker_threads = std::max(1u, std::thread::hardware_concurrency());
+
+        // Every worker scans with a tokenizer of its own, and hence with its own scope stack
+        if(_options.worker_threads > 1)
+        {
+            _pool.reset(new ThreadPool{_options.worker_threads});
+            // Workers collect the statistics of the files they scan
+            TokenizerOptions worker_options {};
+            worker_options.statistics = _options.statistics;
+            worker_options.count_lines = _options.count_lines;
+            worker_options.presize_tokens = _options.presize_tokens;
+            worker_options.split_size = _options.split_size;
+            for(std::size_t index = 0; index < _pool->size(); ++index)
+            {
+                _workers.emplace_back(new Tokenizer{worker_options, _resource});
+                _workers.back()->_owner = this;
+            }
+        }
+        if(_options.lazy_loading && (_options.max_open_files > 0))
+            _open_files.reset(new Semaphore{_options.max_open_files});
+        if(!_options.lazy_loading && (_options.read_ahead > 0))
+            _read_ahead.reset(new ReadAhead{_options.read_ahead});
+        if(_options.retain_scratch)
+            _scratch.reset(new MonotonicResource{INITIAL_SCRATCH, _resource});
+    }
+
+    Tokenizer::~Tokenizer() = default;
+
     TokenizerFeedback Tokenizer::tokenize(const std::string &input_file,
                                           ListOfTokenizedPairs &list_of_tokenized_pairs)
     {
-        // Initialize tokenization
-        ListOfFiles list_of_files{};
+        // Initialize tokenization and generate tokens for every file listed.
+        // Results are staged until the first error in import order is known.
+        const std::chrono::steady_clock::time_point begin = beginStatistics();
+        beginScratch(false);
+        ListOfFiles list_of_files{scratch()};
         TokenizerFeedback feedback{};
-        initialize(input_file, list_of_files, feedback);
+        std::deque<TokenizedPairs, PolymorphicAllocator<TokenizedPairs>> staged_pairs{scratch()};
+        const ArenaString root {input_file.data(), input_file.size(), scratch()};
+        std::size_t count = generateAll(&root, &root + 1,
+                                        list_of_files,
+                                        [this, &staged_pairs] (File &file) -> FileTask
+        {
+            staged_pairs.emplace_back(sparePairs());
+            return pairsTask(file, staged_pairs.back());
+        }, feedback);
+        std::move(std::begin(staged_pairs), std::begin(staged_pairs) + count,
+                  std::back_inserter(list_of_tokenized_pairs));
 
-        // Continue to generate tokens if there were no initialization errors.
+        // Cleanup
+        endStatistics(list_of_files, begin);
+        cleanup(list_of_files);
+        
+        return feedback;
+    }
+
+    TokenizerFeedback Tokenizer::tokenize(const std::vector<std::string> &input_files,
+                                          TokenizedBatch &tokenized_batch)
+    {
+        // The import graphs of all roots are resolved into one list of files,
+        // so that files shared by several roots are tokenized once.
+        const std::chrono::steady_clock::time_point begin = beginStatistics();
+        beginScratch(false);
+        ListOfFiles list_of_files{scratch()};
+        TokenizerFeedback feedback{};
+        std::deque<TokenizedPairs, PolymorphicAllocator<TokenizedPairs>> staged_pairs{scratch()};
+        ListOfFileNames roots{scratch()};
+        for(const std::string &input_file : input_files)
+            roots.emplace_back(input_file.data(), input_file.size(), scratch());
+        ArenaVector<std::size_t> root_files{scratch()};
+
+        // The batch is replaced, pairs handed back with recycle() are refilled
+        tokenized_batch.files.clear();
+        tokenized_batch.imports.clear();
+        tokenized_batch.roots.clear();
+        tokenized_batch.closures.clear();
+        recycle(tokenized_batch.pairs);
+        std::size_t count = generateAll(roots.data(), roots.data() + roots.size(),
+                                        list_of_files,
+                                        [this, &staged_pairs] (File &file) -> FileTask
+        {
+            staged_pairs.emplace_back(sparePairs());
+            return pairsTask(file, staged_pairs.back());
+        }, feedback, &root_files);
+        for(std::size_t index = 0; index < count; ++index)
+        {
+            const File &file = list_of_files[index];
+            tokenized_batch.files.emplace_back(FileName{file.path.data(), file.path.size()});
+            tokenized_batch.pairs.push_back(std::move(staged_pairs[index]));
+            tokenized_batch.imports.emplace_back(std::begin(file.imports), std::end(file.imports));
+        }
+
+        // Every root lists the files of its closure in the order of a call for it alone:
+        // depth-first, every file before its imports and only where first imported
         if(feedback.type == FeedbackType::OK)
         {
-            std::for_each(std::begin(list_of_files),
-                            std::end(list_of_files),
-                            [this, &list_of_tokenized_pairs, &feedback] (File &file)
+            ArenaVector<bool> listed {list_of_files.size(), false, PolymorphicAllocator<bool>{scratch()}};
+            ArenaVector<std::pair<std::size_t, std::size_t>> frames {scratch()};
+            tokenized_batch.roots.assign(std::begin(root_files), std::end(root_files));
+            for(std::size_t root : root_files)
             {
-                if(feedback.type == FeedbackType::OK)
+                std::fill(std::begin(listed), std::end(listed), false);
+                tokenized_batch.closures.emplace_back(1, root);
+                std::vector<std::size_t> &closure = tokenized_batch.closures.back();
+                listed[root] = true;
+                frames.emplace_back(root, 0);
+                while(!frames.empty())
                 {
-                list_of_tokenized_pairs.emplace_back(TokenizedPairs{});
-                generateTokens(file, list_of_tokenized_pairs.back(), feedback);
+                    std::pair<std::size_t, std::size_t> &frame = frames.back();
+                    const ArenaVector<std::size_t> &imports = list_of_files[frame.first].imports;
+                    if(frame.second == imports.size())
+                    {
+                        frames.pop_back();
+                        continue;
+                    }
+                    const std::size_t imported = imports[frame.second++];
+                    if(!listed[imported])
+                    {
+                        listed[imported] = true;
+                        closure.push_back(imported);
+                        frames.emplace_back(imported, 0);
+                    }
                 }
-            });
+            }
         }
 
         // Cleanup
+        endStatistics(list_of_files, begin);
         cleanup(list_of_files);
-        
+
         return feedback;
     }
 
-    void Tokenizer::generateTokens(File &file, TokenizedPairs &pairs,
-                                   TokenizerFeedback &feedback)
+    Tokenizer::FileTask Tokenizer::pairsTask(File &file, TokenizedPairs &pairs)
     {
-        feedback.type = FeedbackType::OK;
-        feedback.file = file.path;
-        Scope scope{ScopeType::SCOPE_EMPTY, ScopeType::SCOPE_EMPTY};
-        std::string line{""};
-        pushStack(scope.current);
-
-        while (file.stream.is_open() && !file.stream.eof() && (feedback.type == FeedbackType::OK))
+        return [this, &file, &pairs] (Tokenizer &worker, TokenizerFeedback &file_feedback)
         {
-            std::getline(file.stream >> std::ws, line);
+            if(file.cached && file.cached->complete)
+            {
+                pairs = file.cached->pairs;
+                file.statistics.tokens = pairs.size();
+                return;
+            }
+            if(openFile(file, file_feedback))
+            {
+                PairsSink sink{pairs};
+                worker.generateTokens(file, sink, file_feedback);
+            }
+            closeFile(file);
 
-            if(!line.empty())
+            // Only files tokenized without errors are cached
+            if(file.cached && (file_feedback.type == FeedbackType::OK))
             {
-                // Check for and remove comments in the line if any
-                std::size_t first_comment_position = line.find_first_of((char) Token::COMMENT);
-                if(first_comment_position < line.npos)
-                    line.erase(first_comment_position);
+                file.cached->pairs = pairs;
+                file.cached->complete = true;
+                _options.token_cache->insert(file.cached);
+            }
+        };
+    }
 
-                if(!line.empty())
+    TokenizerFeedback Tokenizer::tokenize(const std::string &input_file,
+                                          ListOfTokenizedFiles &list_of_tokenized_files)
+    {
+        // Initialize tokenization and generate tokens for every file listed.
+        // The file contents move into the results so that the views remain valid,
+        // results are allocated from the resource of the receiving container.
+        const std::chrono::steady_clock::time_point begin = beginStatistics();
+        beginScratch(true);
+        ListOfFiles list_of_files{scratch()};
+        TokenizerFeedback feedback{};
+        MemoryResource *resource = list_of_tokenized_files.get_allocator().resource();
+        std::deque<TokenizedFile, PolymorphicAllocator<TokenizedFile>> staged_files{scratch()};
+        const ArenaString root {input_file.data(), input_file.size(), scratch()};
+        std::size_t count = generateAll(&root, &root + 1,
+                                        list_of_files,
+                                        [this, &staged_files, resource] (File &file) -> FileTask
+        {
+            staged_files.emplace_back(TokenizedFile{ArenaString{file.path, resource},
+                                                    FileBuffer{},
+                                                    TokenViews{resource}});
+            TokenizedFile &tokenized_file = staged_files.back();
+            return [this, &file, &tokenized_file] (Tokenizer &worker, TokenizerFeedback &file_feedback)
+            {
+                if(openFile(file, file_feedback))
                 {
-                    std::stringstream stream {line};
+                    if(file.buffer.size() <= std::numeric_limits<std::uint32_t>::max())
+                    {
+                        ViewsSink sink{tokenized_file.views, file.buffer.begin()};
+                        worker.generateTokens(file, sink, file_feedback);
+                        tokenized_file.buffer = std::move(file.buffer);
+                    }
+                    else
+                    {
+                        file_feedback.type = FeedbackType::NOK_FILE_ERROR;
+                        file_feedback.file.assign(file.path.data(), file.path.size());
+                    }
+                }
+                closeFile(file);
+            };
+        }, feedback);
+        std::move(std::begin(staged_files), std::begin(staged_files) + count,
+                  std::back_inserter(list_of_tokenized_files));
+
+        // Cleanup
+        endStatistics(list_of_files, begin);
+        cleanup(list_of_files);
+        
+        return feedback;
+    }
 
-                    while (!stream.eof() && (feedback.type == FeedbackType::OK))
+    TokenizerFeedback Tokenizer::tokenize(const std::string &input_file,
+                                          ListOfTokenColumns &list_of_token_columns)
+    {
+        // Initialize tokenization and generate tokens for every file listed,
+        // as for zero-copy results but with the tokens laid out column-wise
+        const std::chrono::steady_clock::time_point begin = beginStatistics();
+        beginScratch(true);
+        ListOfFiles list_of_files{scratch()};
+        TokenizerFeedback feedback{};
+        MemoryResource *resource = list_of_token_columns.get_allocator().resource();
+        std::deque<TokenColumns, PolymorphicAllocator<TokenColumns>> staged_columns{scratch()};
+        const ArenaString root {input_file.data(), input_file.size(), scratch()};
+        std::size_t count = generateAll(&root, &root + 1,
+                                        list_of_files,
+                                        [this, &staged_columns, resource] (File &file) -> FileTask
+        {
+            staged_columns.emplace_back(TokenColumns{ArenaString{file.path, resource},
+                                                     FileBuffer{},
+                                                     ArenaVector<std::uint8_t>{resource},
+                                                     ArenaVector<std::uint32_t>{resource},
+                                                     ArenaVector<std::uint32_t>{resource},
+                                                     ArenaVector<std::uint32_t>{resource}});
+            TokenColumns &token_columns = staged_columns.back();
+            return [this, &file, &token_columns] (Tokenizer &worker, TokenizerFeedback &file_feedback)
+            {
+                if(openFile(file, file_feedback))
+                {
+                    if(file.buffer.size() <= std::numeric_limits<std::uint32_t>::max())
                     {
-                        switch (scope.current)
-                        {
-                        case ScopeType::SCOPE_EMPTY:
-                            scopeEmpty(scope, stream, pairs, feedback);
-                            break;
-                        case ScopeType::SCOPE_ARRAY:
-                            scopeArray(scope, stream, pairs, feedback);
-                            break;
-                        case ScopeType::SCOPE_OBJECT:
-                            scopeObject(scope, stream, pairs, feedback);
-                            break;
-                        case ScopeType::SCOPE_KEY:
-                            scopeKey(scope, stream, pairs, feedback);
-                            break;
-                        case ScopeType::SCOPE_STRING:
-                            scopeString(scope, stream, pairs, feedback);
-                            break;
-                        case ScopeType::SCOPE_NUMBER:
-                            scopeNumber(scope, stream, pairs, feedback);
-                            break;
-                        case ScopeType::SCOPE_LITERAL:
-                            scopeLiteral(scope, stream, pairs, feedback);
-                            break;
-                        default:
-                            break;
-                        }
+                        ColumnsSink sink{token_columns, file.buffer.begin()};
+                        worker.generateTokens(file, sink, file_feedback);
+                        token_columns.buffer = std::move(file.buffer);
                     }
+                    else
+                    {
+                        file_feedback.type = FeedbackType::NOK_FILE_ERROR;
+                        file_feedback.file.assign(file.path.data(), file.path.size());
+                    }
+                }
+                closeFile(file);
+            };
+        }, feedback);
+        std::move(std::begin(staged_columns), std::begin(staged_columns) + count,
+                  std::back_inserter(list_of_token_columns));
+
+        // Cleanup
+        endStatistics(list_of_files, begin);
+        cleanup(list_of_files);
+
+        return feedback;
+    }
+
+    TokenizerFeedback Tokenizer::tokenize(const std::string &input_file,
+                                          TokenHandler &handler)
+    {
+        // Initialize tokenization
+        const std::chrono::steady_clock::time_point begin = beginStatistics();
+        beginScratch(false);
+        ListOfFiles list_of_files{scratch()};
+        TokenizerFeedback feedback{};
+        const ArenaString root {input_file.data(), input_file.size(), scratch()};
+        initialize(&root, &root + 1, list_of_files, FileListener{}, feedback);
+
+        // Events are delivered in order from this thread, so files are generated one after the other.
+        // With lazy loading only one file is held in memory at a time.
+        HandlerSink sink{handler};
+        for(std::size_t index = 0; (index < list_of_files.size()) && (feedback.type == FeedbackType::OK); ++index)
+        {
+            File &file = list_of_files[index];
+            const StringView path{file.path.data(), file.path.size()};
+            handler.onFileBegin(path);
+            if(file.cached && file.cached->complete)
+            {
+                file.statistics.tokens = file.cached->pairs.size();
+                for(const TokenizedPair &pair : file.cached->pairs)
+                {
+                    if(pair.token == Token::NUMBER)
+                        sink.emitNumber(pair.value.data(), pair.value.size(), pair.number);
+                    else
+                        sink.emit(pair.token, pair.value.data(), pair.value.size());
                 }
             }
+            else
+            {
+                if(openFile(file, feedback))
+                    generateTokens(file, sink, feedback);
+                closeFile(file);
+            }
+            if(feedback.type == FeedbackType::OK)
+                handler.onFileEnd(path);
+        }
+
+        // Cleanup
+        endStatistics(list_of_files, begin);
+        cleanup(list_of_files);
+
+        return feedback;
+    }
+
+    bool Tokenizer::openFile(File &file, TokenizerFeedback &feedback)
+    {
+        // Eagerly loaded files are complete since import resolution,
+        // files found in the token cache were not read at all
+        const bool cached = file.cached && file.cached->complete;
+        if(!_options.lazy_loading && !cached)
+            return true;
+
+        // The slot is held until the file is closed, also if loading fails
+        if(_open_files)
+            _open_files->acquire();
+        const bool collect = collecting();
+        const std::chrono::steady_clock::time_point begin = collect ? std::chrono::steady_clock::now()
+                                                                    : std::chrono::steady_clock::time_point{};
+        const bool loaded = _provider->load(file.path.c_str(), file.buffer, _contents);
+        if(collect)
+            file.statistics.load_time += nanosecondsSince(begin);
+        if(loaded)
+            return true;
+
+        feedback.type = FeedbackType::NOK_FILE_ERROR;
+        feedback.file.assign(file.path.data(), file.path.size());
+        return false;
+    }
+
+    void Tokenizer::closeFile(File &file)
+    {
+        // Contents moved into zero-copy results stay alive with them
+        file.buffer = FileBuffer{};
+        if(_open_files)
+            _open_files->release();
+    }
+
+    std::size_t Tokenizer::generateAll(const ArenaString *first_root,
+                                       const ArenaString *last_root,
+                                       ListOfFiles &list_of_files,
+                                       const FileScheduler &schedule,
+                                       TokenizerFeedback &feedback,
+                                       ArenaVector<std::size_t> *root_files)
+    {
+        // Every file is scheduled as soon as its import statements are resolved.
+        // Workers tokenize it while the rest of the import graph is still being walked.
+        std::deque<FileTask, PolymorphicAllocator<FileTask>> tasks{scratch()};
+        std::deque<TokenizerFeedback, PolymorphicAllocator<TokenizerFeedback>> feedbacks{scratch()};
+        initialize(first_root, last_root, list_of_files, [this, &schedule, &tasks, &feedbacks] (File &file)
+        {
+            tasks.emplace_back(schedule(file));
+            feedbacks.emplace_back();
+            if(_pool)
+            {
+                const FileTask &task = tasks.back();
+                TokenizerFeedback &file_feedback = feedbacks.back();
+                _pool->submit([this, &task, &file_feedback] (std::size_t worker)
+                {
+                    task(*_workers[worker], file_feedback);
+                });
+            }
+        }, feedback, root_files);
+        if(_pool)
+            _pool->wait();
+
+        // Nothing is generated for an import graph that failed to resolve
+        if(feedback.type != FeedbackType::OK)
+            return 0;
+
+        // Files are generated in order and generation stops at the first error.
+        // Concurrent generation reports the same results as the serial one:
+        // the first failing file in order decides the feedback, later results are dropped.
+        for(std::size_t index = 0; index < tasks.size(); ++index)
+        {
+            if(!_pool)
+                tasks[index](*this, feedbacks[index]);
+            if(feedbacks[index].type != FeedbackType::OK)
+            {
+                feedback = feedbacks[index];
+                return index + 1;
+            }
+        }
+        return tasks.size();
+    }
+
+    void Tokenizer::generateTokens(File &file, TokenSink &sink,
+                                   TokenizerFeedback &feedback)
+    {
+        feedback.type = FeedbackType::OK;
+        Scope scope{ScopeType::SCOPE_EMPTY, ScopeType::SCOPE_EMPTY};
+        Cursor cursor{file.buffer.begin(),
+                      file.buffer.begin() + file.body,
+                      file.buffer.end()};
+        // Scopes left open by a file in error are dropped
+        _depth = 0;
+        _max_depth = 0;
+        pushStack(scope.current);
+
+        // Tokens are counted on their way to the sink only while collecting statistics
+        const bool collect = collecting();
+        const std::chrono::steady_clock::time_point begin = collect ? std::chrono::steady_clock::now()
+                                                                    : std::chrono::steady_clock::time_point{};
+        CountingSink counting_sink{sink};
+        TokenSink &target = collect ? static_cast<TokenSink &>(counting_sink) : sink;
+        if(_options.presize_tokens)
+            target.reserve(cursor.position, cursor.end);
+
+        // Scan the file body in one pass, values are free to span line breaks.
+        // Large bodies are split across the workers instead, if the sink takes chunks.
+        std::size_t split_tokens {0};
+        if(!generateSplit(file, sink, target, split_tokens, feedback))
+        {
+            while (!cursor.eof() && (feedback.type == FeedbackType::OK))
+                scanStep(scope, cursor, target, feedback);
         }
         popStack();
 
-        // Clean up feedback before returning
+        if(collect)
+        {
+            file.statistics.generate_time += nanosecondsSince(begin);
+            file.statistics.bytes = file.buffer.size();
+            if(_options.count_lines)
+            {
+                file.statistics.lines = static_cast<std::size_t>(std::count(file.buffer.begin(), file.buffer.end(), (char) Token::NEW_LINE));
+                if((file.buffer.size() > 0) && (*(file.buffer.end() - 1) != (char) Token::NEW_LINE))
+                    ++file.statistics.lines;
+            }
+            file.statistics.tokens = counting_sink.count() + split_tokens;
+            file.statistics.max_depth = _max_depth;
+        }
+
+        // Report the file only in the event of errors
         if (feedback.type == FeedbackType::OK)
             feedback.file = feedback.snap = std::string{""};
+        else
+            feedback.file.assign(file.path.data(), file.path.size());
     }
     
-    void Tokenizer::pushStack(ScopeType scope_type)
+    void Tokenizer::scanStep(Scope &scope, Cursor &cursor, TokenSink &sink,
+                             TokenizerFeedback &feedback)
+    {
+        // Advance by one call of the handler of the current scope
+        switch (scope.current)
+        {
+        case ScopeType::SCOPE_EMPTY:
+            scopeEmpty(scope, cursor, sink, feedback);
+            break;
+        case ScopeType::SCOPE_ARRAY:
+            scopeArray(scope, cursor, sink, feedback);
+            break;
+        case ScopeType::SCOPE_OBJECT:
+            scopeObject(scope, cursor, sink, feedback);
+            break;
+        case ScopeType::SCOPE_KEY:
+            scopeKey(scope, cursor, sink, feedback);
+            break;
+        case ScopeType::SCOPE_STRING:
+            scopeString(scope, cursor, sink, feedback);
+            break;
+        case ScopeType::SCOPE_NUMBER:
+            scopeNumber(scope, cursor, sink, feedback);
+            break;
+        case ScopeType::SCOPE_LITERAL:
+            scopeLiteral(scope, cursor, sink, feedback);
+            break;
+        default:
+            break;
+        }
+    }
+
+    bool Tokenizer::pushStack(ScopeType scope_type)
     {
-        _last_begun.push(scope_type);
+        if(_depth == MAX_SCOPE_DEPTH)
+            return false;
+        _last_begun[_depth++] = static_cast<unsigned char>(scope_type);
+        if(COLLECT_STATISTICS && (_depth > _max_depth))
+            _max_depth = _depth;
+        return true;
     }
 
     void Tokenizer::popStack()
     {
-        _last_begun.pop();
+        if(_depth > 0)
+            --_depth;
     }
     
     ScopeType Tokenizer::stackTop()
     {
-        return _last_begun.top();
+        return (_depth > 0) ? static_cast<ScopeType>(_last_begun[_depth - 1]) : ScopeType::SCOPE_EMPTY;
     }
     
     void Tokenizer::cleanup(ListOfFiles& list_of_files)
     {
         std::for_each(std::begin(list_of_files), std::end(list_of_files), [] (File& file) {
-            file.stream.close();
+            file.buffer = FileBuffer{};
         });
     }
+
+    void Tokenizer::beginScratch(bool results_keep_contents)
+    {
+        // Scratch memory of the call before is no longer in use. Contents loaded for the duration
+        // of the call are read into it as well, unless they move into the results or are loaded
+        // lazily to hold few files at a time. They are then loaded on this thread only,
+        // workers merely give them back, which the scratch memory ignores.
+        if(_scratch)
+            _scratch->release();
+        _contents = (_scratch && !results_keep_contents && !_options.lazy_loading) ? _scratch.get() : _resource;
+    }
+
+    TokenizedPairs Tokenizer::sparePairs()
+    {
+        if(_spare_pairs.empty())
+            return TokenizedPairs{};
+        TokenizedPairs pairs {std::move(_spare_pairs.back())};
+        _spare_pairs.pop_back();
+        return pairs;
+    }
+
+    void Tokenizer::recycle(ListOfTokenizedPairs &list_of_tokenized_pairs)
+    {
+        for(TokenizedPairs &pairs : list_of_tokenized_pairs)
+        {
+            pairs.clear();
+            _spare_pairs.push_back(std::move(pairs));
+        }
+        list_of_tokenized_pairs.clear();
+    }
+
+    void Tokenizer::reset()
+    {
+        _depth = 0;
+        _max_depth = 0;
+        std::vector<TokenizedPairs>{}.swap(_spare_pairs);
+        _contents = _resource;
+        if(_scratch)
+            _scratch.reset(new MonotonicResource{INITIAL_SCRATCH, _resource});
+    }
+
+    std::chrono::steady_clock::time_point Tokenizer::beginStatistics()
+    {
+        if(!collecting())
+            return std::chrono::steady_clock::time_point{};
+
+        // The list of files keeps its capacity from call to call
+        TokenizerStatistics &statistics = *_options.statistics;
+        std::vector<FileStatistics> files {std::move(statistics.files)};
+        files.clear();
+        statistics = TokenizerStatistics{};
+        statistics.files = std::move(files);
+        return std::chrono::steady_clock::now();
+    }
+
+    void Tokenizer::endStatistics(const ListOfFiles &list_of_files, std::chrono::steady_clock::time_point begin)
+    {
+        if(!collecting())
+            return;
+
+        TokenizerStatistics &statistics = *_options.statistics;
+        for(const File &file : list_of_files)
+        {
+            statistics.files.push_back(file.statistics);
+            statistics.files.back().path.assign(file.path.data(), file.path.size());
+            statistics.bytes += file.statistics.bytes;
+            statistics.lines += file.statistics.lines;
+            statistics.tokens += file.statistics.tokens;
+            statistics.max_depth = std::max(statistics.max_depth, file.statistics.max_depth);
+            statistics.load_time += file.statistics.load_time;
+            statistics.generate_time += file.statistics.generate_time;
+        }
+        statistics.total_time = nanosecondsSince(begin);
+    }
 }
\ No newline at end of file
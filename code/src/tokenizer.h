@@ -3,9 +3,18 @@
 
 #include <string>
 #include <vector>
-#include <fstream>
 #include <sstream>
-#include <stack>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+#include "memory.h"
+#include "buffer.h"
 
 /* ejson library namespace */
 namespace ejson
@@ -13,12 +22,45 @@ namespace ejson
 
     /* Types and datastructures for file-handling */
     typedef std::string FileName;
+    typedef ArenaVector<ArenaString> ListOfFileNames;
+    struct CachedFile;
+
+    /* Counters of one file of a tokenize call, see TokenizerStatistics.
+       Files found in the token cache are neither loaded nor scanned, only their tokens count. */
+    struct FileStatistics
+    {
+        FileName path {};
+        std::size_t bytes {0};
+        std::size_t lines {0};
+        std::size_t tokens {0};
+        // Peak depth of the scope stack while scanning the file
+        std::size_t max_depth {0};
+        // Nanoseconds spent loading and scanning the file
+        std::uint64_t load_time {0};
+        std::uint64_t generate_time {0};
+    };
+
     struct File
     {
-        const std::string path;
-        std::ifstream stream;
+        ArenaString path;
+        FileBuffer buffer;
+        std::size_t body {0};
+        ArenaVector<std::size_t> imports;
+        // Entry of the file in the token cache in use, complete if found unchanged
+        std::shared_ptr<CachedFile> cached {};
+        FileStatistics statistics {};
+    };
+    // References to listed files stay valid while the list grows
+    typedef std::deque<File, PolymorphicAllocator<File>> ListOfFiles;
+
+    /* Resolved import graph of a root file. Files are listed in the order they are
+       tokenized, imports[i] lists the positions of the files imported by file i
+       in the order of their import statements. */
+    struct ImportGraph
+    {
+        std::vector<FileName> files {};
+        std::vector<std::vector<std::size_t>> imports {};
     };
-    typedef std::vector<File> ListOfFiles;
 
     /* Types and datastructures for token-handling */
     enum ScopeType
@@ -31,6 +73,16 @@ namespace ejson
         SCOPE_NUMBER,
         SCOPE_LITERAL
     };
+    // Nesting depth of the scope stack, values count as one level; deeper input is a parser error
+    static const std::size_t MAX_SCOPE_DEPTH = 1024;
+
+    // Statistics are collected for tokenizers given a statistics block, see TokenizerOptions.
+    // Builds with EJSON_DISABLE_STATISTICS leave out their collection altogether.
+#if defined(EJSON_DISABLE_STATISTICS)
+    static const bool COLLECT_STATISTICS = false;
+#else
+    static const bool COLLECT_STATISTICS = true;
+#endif
     struct Scope
     {
         ScopeType previous {ScopeType::SCOPE_EMPTY};
@@ -55,24 +107,190 @@ namespace ejson
         LITERAL_FALSE               = 'f',
         PATH_SEPARATOR              = '/',
         STRING_DELIMITER            = '"',
+        MINUS_SIGN                  = '-',
         BLANK_SPACE                 = ' ',
         NEW_LINE                    = '\n'
     };
     typedef std::vector<Token> Tokens;
+
+    /* Types and datastructures for number-handling.
+       Integers that fit into int64_t are INTEGER and larger positive ones UNSIGNED,
+       numbers with a fraction or an exponent, and integers beyond 64 bits, are REAL. */
+    enum NumberType : unsigned char
+    {
+        NUMBER_NONE,
+        NUMBER_INTEGER,
+        NUMBER_UNSIGNED,
+        NUMBER_REAL
+    };
+    struct Number
+    {
+        NumberType type {NumberType::NUMBER_NONE};
+        union
+        {
+            std::int64_t integer {0};
+            std::uint64_t unsigned_integer;
+            double real;
+        };
+
+        // Value of any type converted to a double
+        double toDouble() const
+        {
+            return (type == NumberType::NUMBER_REAL) ? real :
+                   (type == NumberType::NUMBER_UNSIGNED) ? static_cast<double>(unsigned_integer) :
+                   static_cast<double>(integer);
+        }
+    };
+
+    // Symbol of tokens other than interned keys, see SymbolTable
+    static const std::uint32_t NO_SYMBOL = 0xFFFFFFFFu;
+
     struct TokenizedPair
     {
         Token token {Token::UNDEFINED};
+        // Interned KEY tokens have a symbol instead of a value
+        std::uint32_t symbol {NO_SYMBOL};
         std::string value {""};
+        // Decoded value of NUMBER tokens
+        Number number {};
     };
     typedef std::vector<TokenizedPair> TokenizedPairs;
     typedef std::vector<TokenizedPairs> ListOfTokenizedPairs;
 
+    /* Tokens of several root files sharing imports, every file tokenized once.
+       files, pairs and imports hold every file of the union of the import graphs,
+       as ImportGraph does. roots[r] is the position of root file r, closures[r] the positions
+       of the files a call for that root alone would list, in the same order. */
+    struct TokenizedBatch
+    {
+        std::vector<FileName> files {};
+        ListOfTokenizedPairs pairs {};
+        std::vector<std::vector<std::size_t>> imports {};
+        std::vector<std::size_t> roots {};
+        std::vector<std::vector<std::size_t>> closures {};
+    };
+
+    /* Types and datastructures for zero-copy token-handling */
+    class StringView
+    {
+    private:
+        const char *_data {nullptr};
+        std::size_t _size {0};
+
+    public:
+        StringView() = default;
+        StringView(const char *data, std::size_t size) : _data{data}, _size{size} {}
+        const char *data() const { return _data; }
+        std::size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+        const char *begin() const { return _data; }
+        const char *end() const { return _data + _size; }
+        char operator[](std::size_t index) const { return _data[index]; }
+        std::string str() const { return std::string{_data, _size}; }
+        bool operator==(const StringView &other) const
+        {
+            return (_size == other._size) && ((_size == 0) || (std::memcmp(_data, other._data, _size) == 0));
+        }
+        bool operator!=(const StringView &other) const { return !(*this == other); }
+#if __cplusplus >= 201703L
+        operator std::string_view() const { return std::string_view{_data, _size}; }
+#endif
+    };
+
+    // Decode the text of a number: decimal with optional sign, fraction and exponent, or
+    // hexadecimal integers such as 0x80000000. Independent of the locale, without allocation.
+    // False if the text is not a number.
+    bool decodeNumber(StringView, Number &);
+    struct TokenView
+    {
+        Token token {Token::UNDEFINED};
+        std::uint32_t offset {0};
+        std::uint32_t length {0};
+    };
+    typedef ArenaVector<TokenView> TokenViews;
+    struct TokenizedFile
+    {
+        ArenaString path {};
+        FileBuffer buffer {};
+        TokenViews views {};
+
+        // Value of a token, valid for as long as this file is alive
+        StringView value(const TokenView &view) const
+        {
+            return StringView{buffer.begin() + view.offset, view.length};
+        }
+
+        // Value of a NUMBER token, decoded on access
+        Number number(const TokenView &view) const
+        {
+            Number decoded {};
+            decodeNumber(value(view), decoded);
+            return decoded;
+        }
+    };
+    typedef ArenaVector<TokenizedFile> ListOfTokenizedFiles;
+
+    /* Types and datastructures for column-wise token-handling.
+       The tokens of a file are held as parallel arrays, so that a walk over their kinds
+       reads one byte per token. The match of an object or array begin is the index of its end,
+       that of any other token is its own index: a container is skipped in one step. */
+    struct TokenColumns
+    {
+        ArenaString path {};
+        FileBuffer buffer {};
+        ArenaVector<std::uint8_t> kinds {};
+        ArenaVector<std::uint32_t> offsets {};
+        ArenaVector<std::uint32_t> lengths {};
+        ArenaVector<std::uint32_t> matches {};
+
+        std::size_t size() const { return kinds.size(); }
+        Token token(std::size_t index) const { return static_cast<Token>(kinds[index]); }
+
+        // Value of a token, valid for as long as this file is alive
+        StringView value(std::size_t index) const
+        {
+            return StringView{buffer.begin() + offsets[index], lengths[index]};
+        }
+
+        // Value of a NUMBER token, decoded on access
+        Number number(std::size_t index) const
+        {
+            Number decoded {};
+            decodeNumber(value(index), decoded);
+            return decoded;
+        }
+
+        // Index of the token after the given one, including the contents of a container
+        std::size_t skip(std::size_t index) const { return matches[index] + 1; }
+    };
+    typedef ArenaVector<TokenColumns> ListOfTokenColumns;
+
+    /* Types and datastructures for on-demand queries, see Tokenizer::index.
+       The structural index of a file holds the offsets of its braces, brackets and colons
+       outside of strings and comments, in order. As for token columns, the match of an
+       object or array begin is the index of its end, that of any other entry its own index. */
+    struct StructuralIndex
+    {
+        ArenaString path {};
+        FileBuffer buffer {};
+        ArenaVector<std::uint32_t> offsets {};
+        ArenaVector<std::uint32_t> matches {};
+
+        std::size_t size() const { return offsets.size(); }
+        char structure(std::size_t index) const { return buffer.begin()[offsets[index]]; }
+
+        // Index of the entry after the given one, including the contents of a container
+        std::size_t skip(std::size_t index) const { return matches[index] + 1; }
+    };
+    typedef ArenaVector<StructuralIndex> ListOfStructuralIndexes;
+
     /* Types and datastructures for feedback-handling */
     enum FeedbackType
     {
         OK,
         NOK_FILE_ERROR,
-        NOK_PARSER_ERROR
+        NOK_PARSER_ERROR,
+        NOK_IMPORT_CYCLE
     };
     struct TokenizerFeedback
     {
@@ -81,30 +299,232 @@ namespace ejson
         std::string snap {""};
     };
 
+    /* Statistics of the last call of a tokenizer, see TokenizerOptions. Times are in nanoseconds.
+       Import resolution includes loading the files that are not loaded lazily; with several
+       workers, load and generate times add up across workers and may exceed the total time. */
+    struct TokenizerStatistics
+    {
+        std::uint64_t total_time {0};
+        std::uint64_t resolve_time {0};
+        std::uint64_t load_time {0};
+        std::uint64_t generate_time {0};
+        std::size_t bytes {0};
+        std::size_t lines {0};
+        std::size_t tokens {0};
+        std::size_t max_depth {0};
+        // Import statements, and those naming a file already listed
+        std::size_t imports {0};
+        std::size_t imports_deduplicated {0};
+        // Every file listed, in the order of ImportGraph
+        std::vector<FileStatistics> files {};
+    };
+
+    // Nanoseconds since the given point in time
+    inline std::uint64_t nanosecondsSince(std::chrono::steady_clock::time_point begin)
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - begin).count());
+    }
+
+    /* Tokenized files shared across calls, see cache.h */
+    class TokenCache;
+
+    /* Source of the contents of eJSON files, see provider.h */
+    class FileProvider;
+
+    /* Binary serialization of tokenized files, see tape.h */
+    class TokenTape;
+
+    /* Table of interned keys, see symbols.h */
+    class SymbolTable;
+
+    /* Receiver of tokenization events, see handler.h */
+    class TokenHandler;
+
+    /* Tokenizer for input arriving in chunks, see stream.h */
+    class StreamTokenizer;
+
+    /* Settings of a tokenizer */
+    struct TokenizerOptions
+    {
+        // Number of files tokenized concurrently, 0 selects one per hardware thread.
+        // With more than one worker the memory resources in use must be thread-safe,
+        // see SynchronizedResource.
+        std::size_t worker_threads {1};
+
+        // Read only the import statements while resolving imports, and every file
+        // in full just in time for its tokenization. With a limit of open files
+        // above 0, at most that many files are loaded and tokenized at once.
+        bool lazy_loading {false};
+        std::size_t max_open_files {0};
+
+        // Cache of tokenized files shared across calls, see cache.h.
+        // Files found unchanged in it are neither read nor tokenized again.
+        TokenCache *token_cache {nullptr};
+
+        // Source of the root file and its imports, see provider.h.
+        // Files are read from disk by default.
+        FileProvider *file_provider {nullptr};
+
+        // Statistics of every call are written here, replacing those of the call before.
+        // The block must not be shared by tokenizers in use at the same time.
+        TokenizerStatistics *statistics {nullptr};
+
+        // Count the lines of every file scanned while collecting statistics, in a pass of its own
+        // over the file; lines are left at 0 otherwise.
+        bool count_lines {false};
+
+        // Keep the scratch state of a call, e.g. the list of files and the import index,
+        // for the calls that follow, so that a tokenizer in steady use stops allocating it.
+        // The memory of the largest call so far stays with the tokenizer until reset().
+        bool retain_scratch {false};
+
+        // Count the tokens of every file body in a quick pass ahead of its scan, so that
+        // pairs, views and columns are reserved once instead of growing while scanning.
+        // Handlers receive tokens as they come and skip the pass.
+        bool presize_tokens {false};
+
+        // With more than one worker, split file bodies larger than this into chunks of about
+        // this size, scanned by several workers at once and joined in order; 0 keeps every
+        // file in one piece. Pairs and views are split, with the same tokens as in one piece.
+        std::size_t split_size {0};
+
+        // Read the imports of every file in the background as soon as its import statements are
+        // resolved, at most this many files at a time, so that reading overlaps with resolving and
+        // tokenizing the files before them; 0 reads every file when it is reached. Files on disk
+        // are read through io_uring on Linux where the kernel allows it. Lazily loaded files are
+        // not read ahead.
+        std::size_t read_ahead {0};
+    };
+
+    /* Scanning position inside a file buffer, see scan.h */
+    struct Cursor;
+
+    /* Receiver of the tokens found in a file, see sink.h */
+    class TokenSink;
+
+    /* Workers for concurrent tokenization, see threadpool.h */
+    class ThreadPool;
+    class Semaphore;
+
+    /* Files read ahead of import resolution, see readahead.h */
+    class ReadAhead;
+
     /* Principal class for the ejson tokenizer */
     class Tokenizer
     {
+        friend class StreamTokenizer;
+
     private:
-        std::stack<ScopeType> _last_begun{};
-        void initialize(const std::string &, ListOfFiles &, TokenizerFeedback &);
-        void resolveImportStatements(const std::string &, std::ifstream &, std::vector<std::string> &, TokenizerFeedback &);
-        void checkForAndParseImportStatement(const std::string &, const std::string &, std::vector<std::string> &, TokenizerFeedback &);
-        void generateTokens(File &, TokenizedPairs &, TokenizerFeedback &);
-        void scopeEmpty(Scope &, std::stringstream &, TokenizedPairs &, TokenizerFeedback &);
-        void scopeArray(Scope &, std::stringstream &, TokenizedPairs &, TokenizerFeedback &);
-        void scopeNumber(Scope &, std::stringstream &, TokenizedPairs &, TokenizerFeedback &);
-        void scopeString(Scope &, std::stringstream &, TokenizedPairs &, TokenizerFeedback &);
-        void scopeLiteral(Scope &, std::stringstream &, TokenizedPairs &, TokenizerFeedback &);
-        void scopeObject(Scope &, std::stringstream &, TokenizedPairs &, TokenizerFeedback &);
-        void scopeKey(Scope &, std::stringstream &, TokenizedPairs &, TokenizerFeedback &);
+        typedef std::function<void(Tokenizer &, TokenizerFeedback &)> FileTask;
+        typedef std::function<FileTask(File &)> FileScheduler;
+        typedef std::function<void(File &)> FileListener;
+        TokenizerOptions _options;
+        MemoryResource *_resource;
+        const FileProvider *_provider;
+        unsigned char _last_begun[MAX_SCOPE_DEPTH];
+        std::size_t _depth {0};
+        std::size_t _max_depth {0};
+        std::unique_ptr<ThreadPool> _pool;
+        std::vector<std::unique_ptr<Tokenizer>> _workers;
+        // Tokenizer owning the workers, this one unless it is a worker itself
+        Tokenizer *_owner;
+        std::unique_ptr<Semaphore> _open_files;
+        std::unique_ptr<ReadAhead> _read_ahead;
+        std::unique_ptr<MonotonicResource> _scratch;
+        MemoryResource *_contents;
+        std::vector<TokenizedPairs> _spare_pairs;
+        void initialize(const ArenaString *, const ArenaString *, ListOfFiles &, const FileListener &, TokenizerFeedback &,
+                        ArenaVector<std::size_t> * = nullptr);
+        bool loadFile(const ArenaString &, ListOfFiles &, ListOfFileNames &, TokenizerFeedback &);
+        void resolveImportStatements(const ArenaString &, File &, ListOfFileNames &, TokenizerFeedback &);
+        void checkForAndParseImportStatement(const ArenaString &, StringView, ListOfFileNames &, TokenizerFeedback &);
+        bool openFile(File &, TokenizerFeedback &);
+        void closeFile(File &);
+        FileTask pairsTask(File &, TokenizedPairs &);
+        std::size_t generateAll(const ArenaString *, const ArenaString *, ListOfFiles &, const FileScheduler &,
+                                TokenizerFeedback &, ArenaVector<std::size_t> * = nullptr);
+        void generateTokens(File &, TokenSink &, TokenizerFeedback &);
+        bool generateSplit(File &, TokenSink &, TokenSink &, std::size_t &, TokenizerFeedback &);
+        const char *generateChunk(const File &, const char *, const char *, Scope &, TokenSink &, TokenizerFeedback &);
+        void restoreStack(const std::vector<unsigned char> &);
+        void generateMember(const StructuralIndex &, std::size_t, TokenSink &, TokenizerFeedback &);
+        void scanStep(Scope &, Cursor &, TokenSink &, TokenizerFeedback &);
+        void scopeEmpty(Scope &, Cursor &, TokenSink &, TokenizerFeedback &);
+        void scopeArray(Scope &, Cursor &, TokenSink &, TokenizerFeedback &);
+        void scopeNumber(Scope &, Cursor &, TokenSink &, TokenizerFeedback &);
+        void scopeString(Scope &, Cursor &, TokenSink &, TokenizerFeedback &);
+        void scopeLiteral(Scope &, Cursor &, TokenSink &, TokenizerFeedback &);
+        void scopeObject(Scope &, Cursor &, TokenSink &, TokenizerFeedback &);
+        void scopeKey(Scope &, Cursor &, TokenSink &, TokenizerFeedback &);
         bool transitionRulesApplied (Scope &, const Token &);
-        void pushStack(ScopeType);
+        bool pushStack(ScopeType);
         void popStack();
         ScopeType stackTop();
         void cleanup(ListOfFiles &);
+        MemoryResource *scratch() const { return _scratch ? _scratch.get() : _resource; }
+        void beginScratch(bool);
+        TokenizedPairs sparePairs();
+        bool collecting() const { return COLLECT_STATISTICS && (_options.statistics != nullptr); }
+        std::chrono::steady_clock::time_point beginStatistics();
+        void endStatistics(const ListOfFiles &, std::chrono::steady_clock::time_point);
+        TokenizerFeedback withRootContents(const std::string &, StringView, const std::function<TokenizerFeedback()> &);
 
     public:
+        // Scratch state of the tokenizer is drawn from the given memory resource,
+        // the heap is used by default
+        Tokenizer();
+        explicit Tokenizer(MemoryResource *);
+        explicit Tokenizer(const TokenizerOptions &, MemoryResource * = newDeleteResource());
+        Tokenizer(const Tokenizer &) = delete;
+        Tokenizer &operator=(const Tokenizer &) = delete;
+        ~Tokenizer();
+
         TokenizerFeedback tokenize(const std::string &, ListOfTokenizedPairs &);
+        TokenizerFeedback tokenize(const std::string &, ListOfTokenizedFiles &);
+        TokenizerFeedback tokenize(const std::string &, ListOfTokenColumns &);
+
+        // Keys are interned into the table instead of copied into every pair,
+        // further files and calls with the same table share its symbols
+        TokenizerFeedback tokenize(const std::string &, ListOfTokenizedPairs &, SymbolTable &);
+
+        // Root files are tokenized together with the union of their imports, replacing the batch.
+        // On errors only the files up to the failing one are held, without roots.
+        TokenizerFeedback tokenize(const std::vector<std::string> &, TokenizedBatch &);
+
+        // Tokens are passed on to the handler as they are found, none are kept.
+        // Tokenization stops at the first error, without ending the file in error.
+        TokenizerFeedback tokenize(const std::string &, TokenHandler &);
+        TokenizerFeedback resolve(const std::string &, ImportGraph &);
+
+        // Structural index of the root file and its imports, without tokenizing them.
+        // The file contents move into the indexes, which are then queried for a few values.
+        TokenizerFeedback index(const std::string &, ListOfStructuralIndexes &);
+
+        // Values at the key path, starting from the top-level object of the file. Every match is
+        // appended as the tokens of its member, the KEY token first; members off the path are
+        // skipped unread. Errors are only found within the members tokenized.
+        TokenizerFeedback query(const StructuralIndex &, const std::vector<std::string> &, ListOfTokenizedPairs &);
+
+        // Matches in the root file and its imports, in the order the files are listed
+        TokenizerFeedback query(const ListOfStructuralIndexes &, const std::vector<std::string> &, ListOfTokenizedPairs &);
+
+        // The root file is given by its contents, imports are loaded from the file provider
+        // relative to the path of the root file. The contents must outlive zero-copy results.
+        TokenizerFeedback tokenize(const std::string &, StringView, ListOfTokenizedPairs &);
+        TokenizerFeedback tokenize(const std::string &, StringView, ListOfTokenizedFiles &);
+        TokenizerFeedback tokenize(const std::string &, StringView, ListOfTokenColumns &);
+        TokenizerFeedback tokenize(const std::string &, StringView, TokenHandler &);
+
+        // Tokens of the root file and its imports from the given tape file, if it is current.
+        // Otherwise the files are tokenized from text and the tape file is written anew.
+        TokenizerFeedback tokenize(const std::string &, TokenTape &, const std::string &);
+
+        // Hand back results of an earlier call, their vectors are refilled by the calls that follow
+        void recycle(ListOfTokenizedPairs &);
+
+        // Free the scratch state and the results kept for reuse
+        void reset();
     };
 }
 